@@ -18,9 +18,10 @@ from bs1116 import plot_bs1116_results
 @click.option("-psub", "--plot_subjects", help="generate separate plots for all subjects", required=False, is_flag=True)
 @click.option("-psti", "--plot_stimuli", help="generate separate plots for all stimuli", required=False,  is_flag=True)
 @click.option("-codecs", "--codec_json_file", help="json file relating filenames to codecs for plotting", required=False, is_flag=False)
+@click.option("-kg", "--keep_glitched_trials", help="keep trials during which the audio dropped out", required=False, is_flag=True)
 @click.option("--debug", is_flag=True, help="Show debugging information.")
 @runez.click.log()
-def main(input_data_dir, output_plots_dir, plot_subjects, plot_stimuli, codec_json_file, debug, log):
+def main(input_data_dir, output_plots_dir, plot_subjects, plot_stimuli, codec_json_file, keep_glitched_trials, debug, log):
     """
     Description of command (shows up in --help)
     """
@@ -44,7 +45,7 @@ def main(input_data_dir, output_plots_dir, plot_subjects, plot_stimuli, codec_js
         codec_map = json.load(open(codec_json_file))
 
     # ==== parse xml files
-    listeners, test_info = parse_xml_results(input_data_dir, codec_map)
+    listeners, test_info = parse_xml_results(input_data_dir, codec_map, keep_glitched_trials)
     if len(listeners) == 0:
         raise ValueError("No listening test results were found in %s!!" % input_data_dir)
 
@@ -0,0 +1,87 @@
+"""
+Converts the listener interaction logs the application writes next to the results
+(*_interactions.bin) to CSV, one row per event
+"""
+import csv
+import os
+import struct
+
+import click
+
+HEADER = struct.Struct("<4siqqq")
+RECORD = struct.Struct("<Bxhiqqqd")
+EVENT_NAMES = ["trial", "switchStimulus", "seek", "loopStart", "loopEnd", "loop", "pause", "resume", "score", "lost"]
+COLUMNS = ["time_s", "trial", "event", "stimulus", "value", "playhead_sample", "playhead_s", "rendered_samples"]
+
+
+def read_interactions(log_file):
+    """
+    Returns the session start in milliseconds since 1970 and the events of log_file, as dicts
+    with the keys in COLUMNS.  Positions are converted to seconds at the sample rate of the
+    trial they belong to.
+    """
+    with open(log_file, "rb") as f:
+        data = f.read()
+
+    if len(data) < HEADER.size:
+        raise ValueError("%s is too short to be an interaction log" % log_file)
+    magic, version, ticks_per_second, _, start_time_ms = HEADER.unpack_from(data, 0)
+    if magic != b"LTIL":
+        raise ValueError("%s is not an interaction log" % log_file)
+    if version != 1:
+        raise ValueError("%s has unsupported version %d" % (log_file, version))
+
+    events = []
+    sample_rate = 0.0
+    # a record cut short by a crash is left out
+    for offset in range(HEADER.size, len(data) - RECORD.size + 1, RECORD.size):
+        event_type, stimulus, trial, ticks, playhead, rendered, value = RECORD.unpack_from(data, offset)
+        name = EVENT_NAMES[event_type] if event_type < len(EVENT_NAMES) else str(event_type)
+        if name == "trial":
+            sample_rate = value
+        events.append({
+            "time_s": ticks / float(ticks_per_second),
+            "trial": trial,
+            "event": name,
+            "stimulus": stimulus if stimulus >= 0 else "",
+            "value": value,
+            "playhead_sample": playhead,
+            "playhead_s": playhead / sample_rate if sample_rate > 0 else "",
+            "rendered_samples": rendered,
+        })
+    return start_time_ms, events
+
+
+def write_csv(events, csv_file):
+    with open(csv_file, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNS)
+        writer.writeheader()
+        writer.writerows(events)
+
+
+@click.command()
+@click.option("-i", "--input_path", help="an interaction log, or a directory of them", required=True)
+@click.option("-o", "--output_dir", help="directory for the csv files, next to the logs if not given", required=False)
+def main(input_path, output_dir):
+    """
+    Writes <log name>.csv for every interaction log found
+    """
+    if os.path.isdir(input_path):
+        log_files = [os.path.join(input_path, name) for name in sorted(os.listdir(input_path))
+                     if name.endswith("_interactions.bin")]
+    else:
+        log_files = [input_path]
+
+    if output_dir and not os.path.isdir(output_dir):
+        os.makedirs(output_dir)
+
+    for log_file in log_files:
+        _, events = read_interactions(log_file)
+        csv_name = os.path.splitext(os.path.basename(log_file))[0] + ".csv"
+        csv_file = os.path.join(output_dir or os.path.dirname(log_file), csv_name)
+        write_csv(events, csv_file)
+        print("%s: %d events -> %s" % (log_file, len(events), csv_file))
+
+
+if __name__ == "__main__":
+    main()
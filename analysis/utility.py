@@ -68,6 +68,27 @@ def add_codec_to_result_xml(results, codec_map=None):
     return results
 
 
+def is_glitched(trial):
+    """
+    :param trial: one trial element of the results
+    :return: True if the audio may have dropped out while the trial was played; results saved before
+             the counts were recorded are taken to be clean
+    """
+    return any(int(trial.get(count, "0")) > 0 for count in ["xruns", "lateCallbacks", "deviceRestarts"])
+
+
+def remove_glitched_trials(results, listener):
+    # drop trials whose ratings may have been given on audio with dropouts
+    trials = results.find('trials')
+    for trial in trials.findall('trial'):
+        if is_glitched(trial):
+            print("--> %s: skipping trial %s (xruns = %s, late callbacks = %s, device restarts = %s)"
+                  % (listener, trial.get('trialName'), trial.get('xruns'), trial.get('lateCallbacks'),
+                     trial.get('deviceRestarts')))
+            trials.remove(trial)
+    return results
+
+
 def get_test_info(root):
     """
     :param root: tree structured data parsed from one xml file
@@ -126,10 +147,11 @@ def create_dataframe(test_results, test_type):
     return pandas.DataFrame.from_dict(codecs, orient='index')
 
 
-def parse_xml_results(input_data_dir, codec_map=None):
+def parse_xml_results(input_data_dir, codec_map=None, keep_glitched_trials=False):
     """
     given a directory of xml files, parse the listening test results
     :param input_data_dir: str, a directory of xml files
+    :param keep_glitched_trials: bool, keep the trials during which the audio may have dropped out
     :return:
         listeners_dict: dictionary, key = "Subject %d: %s" % (index, subjectName)
                                     val = dataframe of the test results
@@ -151,8 +173,10 @@ def parse_xml_results(input_data_dir, codec_map=None):
         print("handling " + str(file))
         tree = elementTree.parse(file)
         root = tree.getroot()
-        test_info = get_test_info(root)
         listener = "Subject " + str(i+1) + ": " + root.find('info').get('subjectName')
+        if not keep_glitched_trials:
+            root = remove_glitched_trials(root, listener)
+        test_info = get_test_info(root)
         results_with_scores = add_codec_to_result_xml(root, codec_map)
         results_df = create_dataframe(results_with_scores, test_info["tag"])
         listeners_dict[listener] = results_df
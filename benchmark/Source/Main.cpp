@@ -0,0 +1,469 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../listening-test/PlaybackEngine.h"
+#include "../../listening-test/AudioThreadGuard.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/**
+    Drives the PlaybackEngine the way the audio device does, with noise stimuli, and reports
+    what each block costs.  No audio device is needed, so it runs on build machines.
+
+        PlaybackBenchmark [--quick] [--seconds N]
+
+    Then records a session with random commands and block sizes and replays its log into a
+    second engine, as the offline renderer does, checking that the output is bit-exact, and
+    plays a loop beyond 2^32 samples to check that positions are not truncated anywhere, and
+    loops a stimulus streamed from disk to check that its loop crossfade plays what memory does.
+    Exits with 1 if the audio thread allocated memory, the replay differs, a position is wrong or
+    the streamed loop differs.
+*/
+
+const double sampleRate = 48000.0;
+const int numStimuli = 4;
+
+struct BenchmarkConfig {
+    int blockSize;
+    int numChannels;
+    int loopLength;     // samples
+    int switchEvery;    // blocks between stimulus switches, 0 for never
+};
+
+struct BenchmarkResult {
+    double nsPerSample; // per sample frame, all channels together
+    double p50Us;
+    double p99Us;
+    double p999Us;
+    double maxUs;
+    double load;        // p99.9 block time over the block duration
+    int64 allocations;
+};
+
+static std::unique_ptr <StimulusSet> createNoiseStimuli(int numChannels, int numSamples) {
+    std::unique_ptr <StimulusSet> set(new StimulusSet);
+    set->trialIndex = 0;
+    set->channelCount = numChannels;
+    set->samplesCount = numSamples;
+    set->sampleRate = sampleRate;
+
+    Random random(1234);
+    for (int i = 0; i < numStimuli; i++) {
+        std::shared_ptr <AudioBuffer<float>> audio(new AudioBuffer<float>(numChannels, numSamples));
+        for (int ch = 0; ch < numChannels; ch++) {
+            float *samples = audio->getWritePointer(ch);
+            for (int n = 0; n < numSamples; n++) {
+                samples[n] = random.nextFloat() - 0.5f;
+            }
+        }
+        set->stimuli.add(new BufferedStimulus(audio));
+
+        /* level matched, as most tests play, so the gain is part of the cost */
+        set->gains.add(0.5f);
+    }
+    return set;
+}
+
+static double getPercentile(const std::vector<double> &sorted, double percentile) {
+    const size_t index = (size_t) (percentile / 100.0 * (double) (sorted.size() - 1) + 0.5);
+    return sorted[jmin(index, sorted.size() - 1)];
+}
+
+static BenchmarkResult run(PlaybackEngine &engine, const BenchmarkConfig &config, double seconds) {
+    engine.setCrossfade(10.0, CROSSFADE_SHAPE_EQUAL_POWER, 256);
+    engine.setRouting(RoutingMatrix());
+    engine.prepare(sampleRate, config.blockSize);
+
+    const PlayerCommand setup[] = {
+            {PlayerCommand::setFragmentStart, 0},
+            {PlayerCommand::setFragmentEnd,   config.loopLength},
+            {PlayerCommand::setPlayLoop,      1},
+            {PlayerCommand::setSample,        0},
+            {PlayerCommand::switchStimulus,   0},
+            {PlayerCommand::resume,           0}
+    };
+    for (const PlayerCommand &command : setup) {
+        engine.applyCommandNow(command);
+    }
+
+    AudioBuffer<float> outputs(config.numChannels, config.blockSize);
+    const int numBlocks = jmax(1000, roundToInt(seconds * sampleRate / config.blockSize));
+    const int warmUpBlocks = numBlocks / 10;
+    std::vector<double> blockNs((size_t) numBlocks);
+
+    int switches = 0;
+    int64 allocations = 0;
+    for (int block = -warmUpBlocks; block < numBlocks; block++) {
+        if (config.switchEvery > 0 && block % config.switchEvery == 0) {
+            const PlayerCommand command = {PlayerCommand::switchStimulus, ++switches % numStimuli};
+            engine.pushCommand(command);
+        }
+
+        const int64 allocationsBefore = getAudioThreadAllocationCount();
+        const int64 start = Time::getHighResolutionTicks();
+        engine.process(outputs.getArrayOfWritePointers(), config.numChannels, config.blockSize);
+        const int64 end = Time::getHighResolutionTicks();
+
+        if (block >= 0) {
+            blockNs[(size_t) block] = Time::highResolutionTicksToSeconds(end - start) * 1.0e9;
+            allocations += getAudioThreadAllocationCount() - allocationsBefore;
+        }
+    }
+
+    double totalNs = 0.0;
+    for (double ns : blockNs) {
+        totalNs += ns;
+    }
+    std::sort(blockNs.begin(), blockNs.end());
+
+    BenchmarkResult result;
+    result.nsPerSample = totalNs / ((double) numBlocks * config.blockSize);
+    result.p50Us = getPercentile(blockNs, 50.0) / 1000.0;
+    result.p99Us = getPercentile(blockNs, 99.0) / 1000.0;
+    result.p999Us = getPercentile(blockNs, 99.9) / 1000.0;
+    result.maxUs = blockNs.back() / 1000.0;
+    result.load = getPercentile(blockNs, 99.9) / (config.blockSize / sampleRate * 1.0e9);
+    result.allocations = allocations;
+    return result;
+}
+
+/* Returns the number of samples that differ between a live session and its replay */
+static int64 checkReplay() {
+    const int numChannels = 8;
+    const int maxBlockSize = 256;
+    Random random(5678);
+
+    PlaybackLog log;
+    log.sampleRate = sampleRate;
+    log.channelCount = numChannels;
+    log.crossfadeMs = 10.0;
+    log.crossfadeShape = CROSSFADE_SHAPE_RAISED_COSINE;
+    log.loopCrossfadeSamples = 256;
+
+    PlaybackEngine live;
+    live.setStimulusSet(createNoiseStimuli(numChannels, 48000));
+    live.setRouting(log.routing);
+    live.setCrossfade(log.crossfadeMs, log.crossfadeShape, log.loopCrossfadeSamples);
+    live.setRecordingEvents(true);
+    live.recordState();
+    live.prepare(sampleRate, maxBlockSize);
+
+    const PlayerCommand setup[] = {
+            {PlayerCommand::setFragmentEnd, 48000},
+            {PlayerCommand::switchStimulus, 0},
+            {PlayerCommand::resume,         0}
+    };
+    for (const PlayerCommand &command : setup) {
+        live.applyCommandNow(command);
+    }
+
+    /* some devices vary their block size, and may exceed the one announced */
+    const int numBlocks = 4000;
+    AudioBuffer<float> liveOutput(numChannels, numBlocks * 2 * maxBlockSize);
+    AudioBuffer<float> block(numChannels, 2 * maxBlockSize);
+    int liveLength = 0;
+    PlaybackEvent event;
+    for (int i = 0; i < numBlocks; i++) {
+        if (random.nextInt(20) == 0) {
+            const PlayerCommand::Type types[] = {PlayerCommand::switchStimulus, PlayerCommand::setSample,
+                                                 PlayerCommand::setFragmentStart, PlayerCommand::setFragmentEnd,
+                                                 PlayerCommand::pause, PlayerCommand::resume,
+                                                 PlayerCommand::resume};
+            const PlayerCommand::Type type = types[random.nextInt(7)];
+            const int value = type == PlayerCommand::switchStimulus ? random.nextInt(numStimuli)
+                                                                    : random.nextInt(48000);
+            const PlayerCommand command = {type, value};
+            live.pushCommand(command);
+        }
+
+        const int numSamples = random.nextInt(i % 500 < 400 ? maxBlockSize : 2 * maxBlockSize) + 1;
+        live.process(block.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ch++) {
+            liveOutput.copyFrom(ch, liveLength, block, ch, 0, numSamples);
+        }
+        liveLength += numSamples;
+        while (live.popEvent(event)) {
+            log.events.add(event);
+        }
+    }
+    live.recordStop();
+    while (live.popEvent(event)) {
+        log.events.add(event);
+    }
+    log.endSample = live.getRenderedSamples();
+    if (live.takeEventsLost())
+        return liveLength;
+
+    PlaybackEngine replayed;
+    replayed.setStimulusSet(createNoiseStimuli(numChannels, 48000));
+    int64 position = 0;
+    int64 differences = 0;
+    const bool complete = replayed.replay(log, numChannels, [&](const AudioBuffer<float> &output, int numSamples) {
+        for (int ch = 0; ch < numChannels; ch++) {
+            for (int n = 0; n < numSamples && position + n < liveLength; n++) {
+                if (std::memcmp(output.getReadPointer(ch, n), liveOutput.getReadPointer(ch, (int) position + n),
+                                sizeof(float)) != 0) {
+                    differences++;
+                }
+            }
+        }
+        position += numSamples;
+        return true;
+    });
+
+    if (!complete || position != liveLength)
+        return jmax(differences, (int64) 1);
+    return differences;
+}
+
+/**
+    A stimulus of any length whose first channel holds the low 16 bits of each sample's position
+    and whose second channel holds bits 32 to 47, exactly representable as floats.
+*/
+class PositionStimulus : public StimulusSource {
+public:
+    void read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) override {
+        for (int n = 0; n < numSamples; n++) {
+            const int64 position = sourceSample + n;
+            dest.setSample(0, destStartSample + n, (float) (position & 0xffff));
+            dest.setSample(1, destStartSample + n, (float) ((position >> 32) & 0xffff));
+        }
+    }
+};
+
+/* Loops over a region past 2^32 samples and returns the number of samples read from the wrong
+   position, plus one if the published playhead is wrong. */
+static int64 checkLongPositions() {
+    const int64 numSamples = ((int64) 1 << 33) + 12345;
+    const int64 loopStart = ((int64) 1 << 32) + 1000;
+    const int64 loopEnd = loopStart + 3000;
+    const int blockSize = 256;
+    const int numBlocks = 40;
+
+    std::unique_ptr <StimulusSet> set(new StimulusSet);
+    set->trialIndex = 0;
+    set->channelCount = 2;
+    set->samplesCount = numSamples;
+    set->sampleRate = sampleRate;
+    set->stimuli.add(new PositionStimulus);
+
+    PlaybackEngine engine;
+    engine.setStimulusSet(std::move(set));
+    engine.setCrossfade(10.0, CROSSFADE_SHAPE_EQUAL_POWER, 0);
+    engine.setRouting(RoutingMatrix());
+    engine.prepare(sampleRate, blockSize);
+
+    const PlayerCommand setup[] = {
+            {PlayerCommand::setFragmentStart, loopStart},
+            {PlayerCommand::setFragmentEnd,   loopEnd},
+            {PlayerCommand::setPlayLoop,      1},
+            {PlayerCommand::setSample,        loopEnd - 100},
+            {PlayerCommand::switchStimulus,   0},
+            {PlayerCommand::resume,           0}
+    };
+    for (const PlayerCommand &command : setup) {
+        engine.applyCommandNow(command);
+    }
+
+    AudioBuffer<float> outputs(2, blockSize);
+    int64 expected = loopEnd - 100;
+    int64 wrong = 0;
+    for (int block = 0; block < numBlocks; block++) {
+        engine.process(outputs.getArrayOfWritePointers(), 2, blockSize);
+        for (int n = 0; n < blockSize; n++) {
+            if (outputs.getSample(0, n) != (float) (expected & 0xffff)
+                || outputs.getSample(1, n) != (float) ((expected >> 32) & 0xffff)) {
+                ++wrong;
+            }
+            if (++expected == loopEnd) {
+                expected = loopStart;
+            }
+        }
+    }
+
+    if (engine.getState().currentSample != expected) {
+        ++wrong;
+    }
+    return wrong;
+}
+
+/* Renders blocks of a loop of a stimulus into output; streamed stimuli are given time to read
+   ahead after every block, so the comparison does not depend on how fast the disk is */
+static void renderLoop(StimulusSource *stimulus, int numChannels, int64 numSamples, int loopFade, bool waitForDisk,
+                       AudioBuffer<float> &output) {
+    const int64 loopStart = 100000;
+    const int64 loopEnd = 110000;
+    const int blockSize = 1024;
+
+    std::unique_ptr <StimulusSet> set(new StimulusSet);
+    set->trialIndex = 0;
+    set->channelCount = numChannels;
+    set->samplesCount = numSamples;
+    set->sampleRate = sampleRate;
+    set->stimuli.add(stimulus);
+
+    PlaybackEngine engine;
+    engine.setStimulusSet(std::move(set));
+    engine.setCrossfade(10.0, CROSSFADE_SHAPE_EQUAL_POWER, loopFade);
+    engine.setRouting(RoutingMatrix());
+    engine.prepare(sampleRate, blockSize);
+
+    const PlayerCommand setup[] = {
+            {PlayerCommand::setFragmentStart, loopStart},
+            {PlayerCommand::setFragmentEnd,   loopEnd},
+            {PlayerCommand::setPlayLoop,      1},
+            {PlayerCommand::setSample,        loopEnd - 5000},
+            {PlayerCommand::switchStimulus,   0},
+            {PlayerCommand::resume,           0}
+    };
+    for (const PlayerCommand &command : setup) {
+        engine.applyCommandNow(command);
+    }
+
+    AudioBuffer<float> block(numChannels, blockSize);
+    for (int pos = 0; pos < output.getNumSamples(); pos += blockSize) {
+        engine.process(block.getArrayOfWritePointers(), numChannels, blockSize);
+        for (int ch = 0; ch < numChannels; ch++) {
+            output.copyFrom(ch, pos, block, ch, 0, jmin(blockSize, output.getNumSamples() - pos));
+        }
+        if (waitForDisk) {
+            Thread::sleep(20);
+        }
+    }
+    engine.releaseStimulusSet();
+}
+
+/* Loops a stimulus streamed from a file far from its start, where the samples the loop crossfade
+   reads are neither in the read-ahead ring nor in the loop head without the crossfade's preroll,
+   and returns the number of samples that differ from playing it from memory */
+static int64 checkStreamedLoop() {
+    const int numChannels = 2;
+    const int numSamples = 200000;
+    const int loopFade = 2048;
+    const int blockSize = 1024;
+    const int numBlocks = 40;       // about four times around the loop
+
+    TemporaryFile temp(".wav");
+    {
+        AudioBuffer<float> noise(numChannels, numSamples);
+        Random random(4321);
+        for (int ch = 0; ch < numChannels; ch++) {
+            for (int n = 0; n < numSamples; n++) {
+                noise.setSample(ch, n, random.nextFloat() - 0.5f);
+            }
+        }
+
+        /* the writer only takes the stream if it could be created */
+        std::unique_ptr <FileOutputStream> stream(new FileOutputStream(temp.getFile()));
+        WavAudioFormat waf;
+        std::unique_ptr <AudioFormatWriter> writer(waf.createWriterFor(stream.get(), sampleRate, numChannels, 24,
+                                                                       StringPairArray(), 0));
+        if (writer == nullptr)
+            return numSamples;
+        stream.release();
+        if (!writer->writeFromAudioSampleBuffer(noise, 0, numSamples))
+            return numSamples;
+    }
+
+    WavAudioFormat waf;
+    std::unique_ptr <AudioFormatReader> memoryReader(waf.createReaderFor(new FileInputStream(temp.getFile()), true));
+    AudioFormatReader *streamReader = waf.createReaderFor(new FileInputStream(temp.getFile()), true);
+    if (memoryReader == nullptr || streamReader == nullptr) {
+        delete streamReader;
+        return numSamples;
+    }
+
+    AudioBuffer<float> fromMemory(numChannels, numBlocks * blockSize);
+    renderLoop(new BufferedStimulus(BufferedStimulus::decode(memoryReader.get(), numChannels, numSamples)),
+               numChannels, numSamples, loopFade, false, fromMemory);
+
+    TimeSliceThread streamingThread("Stimulus streaming");
+    streamingThread.startThread();
+    AudioBuffer<float> streamed(numChannels, numBlocks * blockSize);
+    renderLoop(new StreamingStimulus(streamReader, numChannels, numSamples, loopFade, streamingThread),
+               numChannels, numSamples, loopFade, true, streamed);
+    streamingThread.stopThread(1000);
+
+    /* the first block is played before the reader has caught up with the playhead */
+    int64 differences = 0;
+    for (int ch = 0; ch < numChannels; ch++) {
+        for (int n = blockSize; n < streamed.getNumSamples(); n++) {
+            if (streamed.getSample(ch, n) != fromMemory.getSample(ch, n)) {
+                differences++;
+            }
+        }
+    }
+    return differences;
+}
+
+int main(int argc, char *argv[]) {
+    const StringArray args(argv + 1, argc - 1);
+    const bool quick = args.contains("--quick");
+    const int secondsIndex = args.indexOf("--seconds");
+    const double seconds = secondsIndex >= 0 ? args[secondsIndex + 1].getDoubleValue() : (quick ? 1.0 : 5.0);
+
+    const Array<int> blockSizes = quick ? Array<int>(32, 512) : Array<int>(32, 64, 128, 256, 512, 1024);
+    const Array<int> channelCounts = quick ? Array<int>(2, 64) : Array<int>(2, 8, 16, 32, 64);
+    const Array<int> loopLengths = quick ? Array<int>(100, 48000) : Array<int>(16, 100, 4800, 48000);
+    const Array<int> switchIntervals = quick ? Array<int>(0, 1) : Array<int>(0, 100, 10, 1);
+
+    std::cout << "block  channels   loop  switch   ns/sample   p50 us   p99 us  p99.9 us    max us    load  allocs"
+              << std::endl;
+
+    PlaybackEngine engine;
+    int64 totalAllocations = 0;
+    for (int numChannels : channelCounts) {
+        /* the stimuli are as long as the longest loop */
+        engine.setStimulusSet(createNoiseStimuli(numChannels, loopLengths.getLast()));
+
+        for (int blockSize : blockSizes) {
+            for (int loopLength : loopLengths) {
+                for (int switchEvery : switchIntervals) {
+                    const BenchmarkConfig config = {blockSize, numChannels, loopLength, switchEvery};
+                    const BenchmarkResult result = run(engine, config, seconds);
+                    totalAllocations += result.allocations;
+
+                    std::cout << String(blockSize).paddedLeft(' ', 5)
+                              << String(numChannels).paddedLeft(' ', 10)
+                              << String(loopLength).paddedLeft(' ', 7)
+                              << (switchEvery > 0 ? String(switchEvery) : String("never")).paddedLeft(' ', 8)
+                              << String(result.nsPerSample, 2).paddedLeft(' ', 12)
+                              << String(result.p50Us, 2).paddedLeft(' ', 9)
+                              << String(result.p99Us, 2).paddedLeft(' ', 9)
+                              << String(result.p999Us, 2).paddedLeft(' ', 10)
+                              << String(result.maxUs, 2).paddedLeft(' ', 10)
+                              << (String(result.load * 100.0, 1) + "%").paddedLeft(' ', 8)
+                              << String(result.allocations).paddedLeft(' ', 8)
+                              << std::endl;
+                }
+            }
+        }
+    }
+    engine.releaseStimulusSet();
+
+    const int64 replayDifferences = checkReplay();
+    std::cout << "Replay of a recorded session: "
+              << (replayDifferences == 0 ? String("bit-exact") : String(replayDifferences) + " samples differ")
+              << std::endl;
+
+    const int64 positionErrors = checkLongPositions();
+    std::cout << "Loop beyond 2^32 samples: "
+              << (positionErrors == 0 ? String("correct") : String(positionErrors) + " samples wrong")
+              << std::endl;
+
+    const int64 streamedDifferences = checkStreamedLoop();
+    std::cout << "Streamed loop with crossfade: "
+              << (streamedDifferences == 0 ? String("matches memory") : String(streamedDifferences) + " samples differ")
+              << std::endl;
+
+    if (totalAllocations > 0) {
+        std::cout << "The audio thread allocated memory " << totalAllocations << " time(s)" << std::endl;
+        return 1;
+    }
+    return replayDifferences == 0 && positionErrors == 0 && streamedDifferences == 0 ? 0 : 1;
+}
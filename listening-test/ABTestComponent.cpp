@@ -129,6 +129,7 @@ void ABTestComponent::sliderValueChanged(Slider *s) {
         if (pTrial != NULL) {
             pTrial->responsesMoved.set(0, true);
             pTrial->responsesMoved.set(1, true);
+            testLauncher.recordInteraction(InteractionEvent::score, -1, preferenceSlider.getValue());
         }
     } else {
         return BaseTestComponent::sliderValueChanged(s);
@@ -5,36 +5,88 @@
 
 #include "AudioPlayer.h"
 #include "TestLauncher.h"
-
-const int doCrossFade = true;  // Typically it sounds better with a crossfade.  Some BS.1116 tests require it to be turned off!
+#include "AudioThreadGuard.h"
 
 //==============================================================================
 AudioPlayer::AudioPlayer(File audioSettingsFile) :
-        currentSample(0),
         totalSamples(1), // don't use zero to avoid divide-by-zero problems in playback slider when no test is loaded
-        startSample(0),
-        endSample(0),
-        playInLoop(true),
-        currentStimulus(-1),
-        nextStimulus(-1),
         playerRunning(false),
-        playerPaused(false),
-        channelCount(0),
+        reportedAudioThreadAllocations(0),
+        postedCommands(0),
+        requestedPaused(false),
+        playbackLog(nullptr),
+        interactionLog(nullptr),
+        logger(nullptr),
+        lastXRunCount(0),
+        glitchXRuns(0),
+        glitchRestarts(0),
+        startedSinceCounting(false),
+        stoppedByPlayer(false),
+        runningDevice(nullptr),
+        runningDeviceXRuns(0),
+        nullDeviceType(nullptr),
+        streamingThread("Stimulus streaming"),
         videoComponent(false),
         videoFile(new File(String())) {
+    engine.setRecordingEvents(true);
+    engine.setRecordingTimings(true);
     resetCurrentDevice(audioSettingsFile);
 }
 
 //==============================================================================
 AudioPlayer::~AudioPlayer() {
+    engine.releaseStimulusSet();
+    streamingThread.stopThread(1000);
 }
 
 void AudioPlayer::resetCurrentDevice(File audioSettingsFile) {
+    deviceError = String();
+
+    NullAudioDeviceOptions nullDeviceOptions;
+    std::unique_ptr <XmlElement> nullDeviceState(parseXML(nullDeviceSettingsFile));
+    if (nullDeviceState != nullptr) {
+        nullDeviceOptions.loadFromXml(*nullDeviceState, nullDeviceSettingsFile.getParentDirectory());
+    }
+
+    if (nullDeviceType == nullptr) {
+        /* the platform's own types are only created if none were added before, so ask for them first */
+        audioDeviceManager.getAvailableDeviceTypes();
+        nullDeviceType = new NullAudioIODeviceType;
+        audioDeviceManager.addAudioDeviceType(std::unique_ptr<AudioIODeviceType>(nullDeviceType));
+    }
+    nullDeviceType->setOptions(nullDeviceOptions);
+
     std::unique_ptr <XmlElement> deviceState(parseXML(audioSettingsFile));
     audioDeviceManager.initialise(MAXNUMBEROFDEVICECHANNELS, MAXNUMBEROFDEVICECHANNELS, deviceState.get(), false);
+
+    if (nullDeviceOptions.selectOnStart) {
+        audioDeviceManager.setCurrentAudioDeviceType(NullAudioIODeviceType::typeName, true);
+
+        AudioDeviceManager::AudioDeviceSetup setup;
+        audioDeviceManager.getAudioDeviceSetup(setup);
+        setup.outputDeviceName = NullAudioIODeviceType::deviceName;
+        setup.inputDeviceName = String();
+        setup.sampleRate = nullDeviceOptions.sampleRate;
+        setup.bufferSize = nullDeviceOptions.blockSize;
+        setup.useDefaultOutputChannels = true;
+        const String error(audioDeviceManager.setAudioDeviceSetup(setup, true));
+        if (error.isNotEmpty()) {
+            deviceError = "Cannot open the null audio device: " + error;
+            if (logger != nullptr) {
+                logger->logMessage(deviceError);
+            }
+        }
+    }
     audioDeviceManager.addAudioCallback(this);
 }
 
+void AudioPlayer::setLogger(Logger *newLogger) {
+    logger = newLogger;
+    if (logger != nullptr && deviceError.isNotEmpty()) {
+        logger->logMessage(deviceError);
+    }
+}
+
 int AudioPlayer::getSampleRate() {
     AudioDeviceManager::AudioDeviceSetup ads;
     audioDeviceManager.getAudioDeviceSetup(ads);
@@ -43,9 +95,9 @@ int AudioPlayer::getSampleRate() {
 
 
 // ============================================================================================
-bool AudioPlayer::setPosition(float newPositionPercent) {
-    unsigned int newSamp(static_cast<unsigned int> (floor(newPositionPercent * totalSamples)));
-    if (newSamp < totalSamples) {
+bool AudioPlayer::setPosition(double newPositionPercent) {
+    const int64 newSamp = (int64) floor(newPositionPercent * totalSamples);
+    if (newSamp >= 0 && newSamp < totalSamples) {
         setSample(newSamp);
         if (videoComponent.isVideoOpen()) {
             videoComponent.setPlayPosition(newPositionPercent * videoComponent.getVideoDuration());
@@ -59,145 +111,271 @@ bool AudioPlayer::setPosition(float newPositionPercent) {
 
 //==============================================================================
 void AudioPlayer::audioDeviceAboutToStart(AudioIODevice *device) {
-    AudioDeviceManager::AudioDeviceSetup ads;
-    audioDeviceManager.getAudioDeviceSetup(ads);
-
-    currentStimulus = -1;
-    nextStimulus = -1;
-
-    playerRunning = true;
-    playerPaused = true;
-
-    if (videoFile->exists() && (videoComponent.getCurrentVideoFile() != *videoFile)) {
-        videoComponent.load(*videoFile);
+    engine.prepare(device->getCurrentSampleRate(), device->getCurrentBufferSizeSamples());
+
+    runningDevice = device;
+    runningDeviceXRuns = device->getXRunCount();
+    /* only a device that restarted on its own while the stimuli played; not the player's own
+       stop() and start(), which happen whenever another panel is shown */
+    if (startedSinceCounting.exchange(true) && !stoppedByPlayer && !engine.getState().paused) {
+        ++glitchRestarts;
     }
+    playerRunning = true;
 }
 
 
 //==============================================================================
 void AudioPlayer::audioDeviceStopped() {
+    engine.recordStop();
+    engine.endAudition();
     playerRunning = false;
 }
 
-#define min(a, b) ((a)<(b)?(a):(b))
-#define max(a, b) ((a)>(b)?(a):(b))
-
 void AudioPlayer::start() {
+    if (videoFile->exists() && (videoComponent.getCurrentVideoFile() != *videoFile)) {
+        videoComponent.load(*videoFile);
+    }
+
     if (!isRunning()) {
         audioDeviceManager.addAudioCallback(this);
     }
+    stoppedByPlayer = false;
+    startTimer(40);
 }
 
 void AudioPlayer::stop() {
+    stoppedByPlayer = true;
     if (isRunning()) {
         audioDeviceManager.removeAudioCallback(this);
     }
+    stopTimer();
+    timerCallback();
 
     if (videoComponent.isVideoOpen() && videoComponent.isPlaying())
         videoComponent.stop();
 }
 
-void AudioPlayer::addAudioFromFile(AudioFormatReader *wavReader, int chanCount, int numSamps) {
-    jassert(channelCount == chanCount);
-    AudioBuffer<float> *audioBuffer = new AudioBuffer<float>(chanCount, numSamps);
-    wavReader->read(audioBuffer, 0, numSamps, 0, false, false);
-    audioStimData.add(audioBuffer);
+//==============================================================================
+bool AudioPlayer::isPaused() {
+    /* until the audio thread has caught up with our commands, report what was asked for */
+    const PlaybackState state = engine.getState();
+    return state.appliedCommands == postedCommands ? state.paused : requestedPaused;
 }
 
-void AudioPlayer::releaseAllAudioData() {
-    audioStimData.clear();
+void AudioPlayer::pause() {
+    requestedPaused = true;
+    postCommand(PlayerCommand::pause, 0);
 }
 
-//==============================================================================
-void AudioPlayer::audioDeviceIOCallbackWithContext(const float *const * /*inputChannelData*/,
-                                                   int /*numInputChannels*/,
-                                                   float *const *outputChannelData,
-                                                   int totalNumOutputChannels,
-                                                   int numOutSamples,
-                                                   const AudioIODeviceCallbackContext &context) {
-    ignoreUnused(context);
+void AudioPlayer::resume() {
+    requestedPaused = false;
+    postCommand(PlayerCommand::resume, 0);
+}
 
-    AudioBuffer<float> outputBuffer;
-    outputBuffer.setDataToReferTo(outputChannelData, channelCount, numOutSamples);
-    outputBuffer.clear();
+void AudioPlayer::postCommand(PlayerCommand::Type type, int64 value) {
+    const PlayerCommand command = {type, value, Time::getHighResolutionTicks()};
+    ++postedCommands;
 
-    if (!playerPaused) {
-        if (videoComponent.isVideoOpen()) {
-            int vidPosInSamples = videoComponent.getPlayPosition() * getSampleRate();
+    /* only commands that take effect are recorded, with the playhead from before they did */
+    if (!isRunning()) {
+        /* no callback to apply it, so act as the consumer; this cannot fail */
+        recordInteraction(command);
+        engine.applyCommandNow(command);
+        flushPlaybackLog();
+    } else if (engine.pushCommand(command)) {
+        recordInteraction(command);
+    } else {
+        jassertfalse; // the audio thread has not drained the queue for a long time
+        --postedCommands;
+    }
+}
 
-            if (abs(vidPosInSamples - currentSample) > 2000) {
-                videoComponent.setPlayPosition((double) currentSample / getSampleRate());
-            }
+void AudioPlayer::recordInteraction(const PlayerCommand &command) {
+    if (interactionLog == nullptr)
+        return;
+
+    InteractionEvent::Type type;
+    int stimulus = -1;
+    switch (command.type) {
+        case PlayerCommand::switchStimulus:
+            type = InteractionEvent::switchStimulus;
+            stimulus = (int) command.value;
+            break;
+        case PlayerCommand::setSample:
+            type = InteractionEvent::seek;
+            break;
+        case PlayerCommand::setFragmentStart:
+            type = InteractionEvent::loopStart;
+            break;
+        case PlayerCommand::setFragmentEnd:
+            type = InteractionEvent::loopEnd;
+            break;
+        case PlayerCommand::setPlayLoop:
+            type = InteractionEvent::loop;
+            break;
+        case PlayerCommand::pause:
+            type = InteractionEvent::pause;
+            break;
+        case PlayerCommand::resume:
+            type = InteractionEvent::resume;
+            break;
+        default:
+            return;
+    }
+    interactionLog->record(type, stimulus, (double) command.value, getCurrentSample(), engine.getRenderedSamples());
+}
 
-            if (!videoComponent.isPlaying()) {
-                videoComponent.play();
-            }
+//==============================================================================
+void AudioPlayer::startPlaybackLog(PlaybackLog *log) {
+    jassert(!isRunning());
+    stopPlaybackLog();
+    playbackLog = log;
+    engine.recordState();
+    flushPlaybackLog();
+}
+
+void AudioPlayer::stopPlaybackLog() {
+    flushPlaybackLog();
+    playbackLog = nullptr;
+}
+
+void AudioPlayer::flushPlaybackLog() {
+    /* everything stamped before this count has already been queued */
+    const int64 renderedSamples = engine.getRenderedSamples();
+
+    PlaybackEvent event;
+    while (engine.popEvent(event)) {
+        if (playbackLog != nullptr) {
+            playbackLog->events.add(event);
         }
+    }
 
-        /* Copy as much as possible from input file */
-        int samplesToCopy = max(0, min(numOutSamples, endSample - currentSample));
-        int leftoverSamples = numOutSamples - samplesToCopy;
+    const bool eventsLost = engine.takeEventsLost();
+    if (playbackLog != nullptr) {
+        playbackLog->endSample = jmax(playbackLog->endSample, renderedSamples);
+        playbackLog->complete = playbackLog->complete && !eventsLost;
+    }
+}
 
-        assert(leftoverSamples <= (endSample - startSample));
-        if (currentStimulus != -1) {
-            /* continue playing the stimulus */
-            for (int ch = 0; ch < channelCount; ch++) {
-                outputBuffer.copyFrom(ch, 0, *audioStimData[currentStimulus], ch, currentSample, samplesToCopy);
-            }
+void AudioPlayer::updateDiagnostics() {
+    TimingEvent timing;
+    while (engine.popTiming(timing)) {
+        diagnostics.addEvent(timing, engine.getSampleRate());
+    }
+    if (engine.takeTimingsLost()) {
+        diagnostics.setEventsLost();
+    }
 
-            /* if looping, read the rest of samples from the beginning of the loop */
-            if (leftoverSamples > 0 && playInLoop) {
-                for (int ch = 0; ch < channelCount; ch++) {
-                    /* Read the rest from the start of the file */
-                    outputBuffer.copyFrom(ch, samplesToCopy, *audioStimData[currentStimulus], ch, startSample,
-                                          leftoverSamples);
-                }
-            }
+    AudioIODevice *device = audioDeviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+        return;
 
-            /* cross-fade if stimuli were switched */
-            if (currentStimulus != nextStimulus) {
-                if (doCrossFade) {
-                    AudioBuffer<float> fadeInBuffer(channelCount, numOutSamples);
-                    fadeInBuffer.clear();
-                    for (int ch = 0; ch < channelCount; ch++) {
-                        fadeInBuffer.copyFrom(ch, 0, *audioStimData[nextStimulus], ch, currentSample, samplesToCopy);
-                        if (playInLoop) {
-                            fadeInBuffer.copyFrom(ch, samplesToCopy, *audioStimData[nextStimulus], ch, startSample,
-                                                  leftoverSamples);
-                        }
-
-                        /* do cross-fade */
-                        outputBuffer.applyGainRamp(ch, 0, numOutSamples, 1.0f, 0.0f); // fade-out
-                        outputBuffer.addFromWithRamp(ch, 0, fadeInBuffer.getReadPointer(ch, 0), numOutSamples, 0.0f,
-                                                     1.0f); // add with fade-in
-                    }
-                }
-                currentStimulus = nextStimulus;
-            }
-        } else if (nextStimulus != -1) {
-            /* start playing the first selected stimulus */
-            for (int ch = 0; ch < channelCount; ch++) {
-                outputBuffer.copyFrom(ch, 0, *audioStimData[nextStimulus], ch, currentSample, samplesToCopy);
-                if (leftoverSamples > 0 && playInLoop) {
-                    outputBuffer.copyFrom(ch, samplesToCopy, *audioStimData[nextStimulus], ch, startSample,
-                                          leftoverSamples);
-                }
-            }
-            currentStimulus = nextStimulus;
+    /* the count starts again when the device is reopened */
+    const int xruns = device->getXRunCount();
+    diagnostics.setDeviceReportsXRuns(xruns >= 0);
+    if (xruns >= 0) {
+        diagnostics.addDeviceXRuns(xruns >= lastXRunCount ? xruns - lastXRunCount : xruns);
+        lastXRunCount = xruns;
+    }
+
+    /* a rendered block is heard after the one the device is playing, plus the device's own latency */
+    const double rate = device->getCurrentSampleRate();
+    if (rate > 0.0) {
+        diagnostics.setOutputLatencyMs((device->getOutputLatencyInSamples() + device->getCurrentBufferSizeSamples())
+                                       * 1000.0 / rate);
+    }
+}
+
+void AudioPlayer::timerCallback() {
+    flushPlaybackLog();
+    flushAuditions();
+    updateDiagnostics();
+
+    const int64 allocations = getAudioThreadAllocationCount();
+    if (allocations != reportedAudioThreadAllocations) {
+        const String message("Audio callback called the allocator " +
+                             String(allocations - reportedAudioThreadAllocations) + " time(s)");
+        if (logger != nullptr) {
+            logger->logMessage(message);
+        } else {
+            DBG(message);
         }
+        reportedAudioThreadAllocations = allocations;
+    }
 
-        /* advance audio buffer */
-        currentSample += numOutSamples;
-        if (currentSample >= endSample) {
-            if (playInLoop) {
-                currentSample = startSample + currentSample - endSample;
-            } else {
-                pause();
-                videoComponent.stop();
-                currentSample = startSample;
-            }
+    if (!videoComponent.isVideoOpen())
+        return;
+
+    if (isRunning() && !isPaused()) {
+        const int64 vidPosInSamples = (int64) (videoComponent.getPlayPosition() * engine.getSampleRate());
+        const int64 audioPosInSamples = getCurrentSample();
+
+        if (std::abs(vidPosInSamples - audioPosInSamples) > 2000) {
+            videoComponent.setPlayPosition((double) audioPosInSamples / engine.getSampleRate());
+        }
+
+        if (!videoComponent.isPlaying()) {
+            videoComponent.play();
         }
     } else if (videoComponent.isPlaying()) {
         videoComponent.stop();
     }
 }
+
+void AudioPlayer::startCountingGlitches() {
+    jassert(!isRunning());
+    takeGlitches();
+    startedSinceCounting = false;
+}
+
+void AudioPlayer::flushAuditions() {
+    /* dragging a loop bound ends an audition with every step, more than the queue holds in a trial */
+    Audition audition;
+    while (engine.popAudition(audition)) {
+        auditions.add(audition);
+    }
+}
+
+bool AudioPlayer::popAudition(Audition &audition) {
+    flushAuditions();
+    if (auditions.isEmpty())
+        return false;
+
+    audition = auditions.removeAndReturn(0);
+    return true;
+}
+
+PlaybackGlitches AudioPlayer::takeGlitches() {
+    const PlaybackGlitches glitches = {glitchXRuns.exchange(0), engine.takeGlitchedCallbacks(),
+                                       glitchRestarts.exchange(0)};
+    return glitches;
+}
+
+void AudioPlayer::setStimulusSet(std::unique_ptr <StimulusSet> newSet) {
+    jassert(!isRunning());
+    setTotalSamples(newSet->samplesCount);
+    engine.setStimulusSet(std::move(newSet));
+}
+
+void AudioPlayer::releaseAllAudioData() {
+    engine.releaseStimulusSet();
+}
+
+//==============================================================================
+void AudioPlayer::audioDeviceIOCallbackWithContext(const float *const * /*inputChannelData*/,
+                                                   int /*numInputChannels*/,
+                                                   float *const *outputChannelData,
+                                                   int totalNumOutputChannels,
+                                                   int numOutSamples,
+                                                   const AudioIODeviceCallbackContext &context) {
+    ignoreUnused(context);
+    engine.process(outputChannelData, totalNumOutputChannels, numOutSamples);
+
+    /* the engine counts late and overrunning callbacks; the device's xruns only count while the
+       stimuli play, silence cannot be spoiled */
+    const int deviceXRuns = runningDevice->getXRunCount();
+    if (!engine.isPausedOnAudioThread() && deviceXRuns > runningDeviceXRuns) {
+        glitchXRuns += deviceXRuns - runningDeviceXRuns;
+    }
+    runningDeviceXRuns = deviceXRuns;
+}
@@ -7,11 +7,14 @@
 #define AUDIOPLAYER_H
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "StimulusCache.h"
+#include "PlaybackEngine.h"
+#include "NullAudioDevice.h"
+#include "InteractionLog.h"
 
-#define    MAXNUMBEROFDEVICECHANNELS    64
 
-
-class AudioPlayer : public AudioIODeviceCallback {
+class AudioPlayer : public AudioIODeviceCallback,
+                    private Timer {
 public:
 
     AudioPlayer(File audioSettingsFile);
@@ -20,6 +23,10 @@ public:
 
     void resetCurrentDevice(File audioSettingsFile);
 
+    /* why the device chosen in the settings could not be opened by the last resetCurrentDevice();
+       empty if it was */
+    const String &getDeviceError() const { return deviceError; }
+
     void start();
 
     void stop();
@@ -32,6 +39,8 @@ public:
         return deviceSettings.outputChannels;
     }
 
+    int getNumOutputChannels() { return getOutputChannels().countNumberOfSetBits(); }
+
     void audioDeviceIOCallbackWithContext(const float *const *inputChannelData,
                                           int umInputChannels,
                                           float *const *outputChannelData,
@@ -44,13 +53,15 @@ public:
 
     void audioDeviceStopped() override;
 
-    void switchStimulus(int newStimulusNumber) { nextStimulus = newStimulusNumber; }
+    /* The setters below queue a command for the audio thread, or apply it at once while the
+       player is stopped; the getters read the state the audio thread last published. */
+    void switchStimulus(int newStimulusNumber) { postCommand(PlayerCommand::switchStimulus, newStimulusNumber); }
 
-    int getCurrentStimulus() { return currentStimulus; }
+    int getCurrentStimulus() { return engine.getState().currentStimulus; }
 
-    int getNextStimulus() { return nextStimulus; }
+    int getNextStimulus() { return engine.getState().nextStimulus; }
 
-    int getChannelCount() { return channelCount; }
+    int getChannelCount() { return engine.getChannelCount(); }
 
     double getCurrentPosition() { return (double) getCurrentSample() / totalSamples; }
 
@@ -58,39 +69,99 @@ public:
 
     bool isRunning() { return playerRunning; }
 
-    bool isPaused() { return playerPaused; }
+    bool isPaused();
 
-    int getCurrentSample() { return currentSample; }
+    int64 getCurrentSample() { return engine.getState().currentSample; }
 
-    void setPlayLoop(bool shouldPlayLoop) { playInLoop = shouldPlayLoop; }
+    /* the audio clock: samples rendered since the device started */
+    int64 getRenderedSamples() { return engine.getRenderedSamples(); }
 
-    void setSample(int newSample) { currentSample = newSample; }
+    void setPlayLoop(bool shouldPlayLoop) { postCommand(PlayerCommand::setPlayLoop, shouldPlayLoop ? 1 : 0); }
 
-    void setTotalSamples(int newTotalSamples) { totalSamples = newTotalSamples; }
+    void setSample(int64 newSample) { postCommand(PlayerCommand::setSample, newSample); }
 
-    void setFragmentStartSample(int newStartSample) { startSample = newStartSample; }
+    void setTotalSamples(int64 newTotalSamples) { totalSamples = newTotalSamples; }
 
-    void setFragmentEndSample(int newEndSample) { endSample = newEndSample; }
+    void setFragmentStartSample(int64 newStartSample) { postCommand(PlayerCommand::setFragmentStart, newStartSample); }
 
-    bool setPosition(float newPositionPercent);
+    void setFragmentEndSample(int64 newEndSample) { postCommand(PlayerCommand::setFragmentEnd, newEndSample); }
 
-    void setFragmentStartPosition(float newPositionPercent) {
-        setFragmentStartSample(int(floor(newPositionPercent * totalSamples)));
-    }
+    /* positions are fractions of the stimulus length */
+    bool setPosition(double newPositionPercent);
 
-    void setFragmentEndPosition(float newPositionPercent) {
-        setFragmentEndSample(int(floor(newPositionPercent * totalSamples)));
+    void setFragmentStartPosition(double newPositionPercent) {
+        setFragmentStartSample((int64) floor(newPositionPercent * totalSamples));
     }
 
-    void setChannelCount(int chanCount) { channelCount = chanCount; }
+    void setFragmentEndPosition(double newPositionPercent) {
+        setFragmentEndSample((int64) floor(newPositionPercent * totalSamples));
+    }
 
-    void pause() { playerPaused = true; }
+    void pause();
 
-    void resume() { playerPaused = false; }
+    void resume();
 
     void releaseAllAudioData();
 
-    void addAudioFromFile(AudioFormatReader *wavReader, int chanCount, int numSamps);
+    /* fade used when switching stimuli, taking effect the next time the player starts */
+    void setCrossfade(double fadeMs, crossfadeShapeEnum shape, int loopFadeSamples) {
+        engine.setCrossfade(fadeMs, shape, loopFadeSamples);
+    }
+
+    /* maps stimulus channels onto device outputs; call while the player is stopped */
+    void setRouting(const RoutingMatrix &newRouting) {
+        jassert(!isRunning());
+        engine.setRouting(newRouting);
+    }
+
+    /* replaces the stimuli of the current trial; call while the player is stopped */
+    void setStimulusSet(std::unique_ptr <StimulusSet> newSet);
+
+    /* Records playback into log from now on, starting with the current state, until another log
+       is started or stopPlaybackLog() is called.  The log is not owned and must stay alive until
+       then.  Call while the player is stopped. */
+    void startPlaybackLog(PlaybackLog *log);
+
+    void stopPlaybackLog();
+
+    /* brings the log up to date with what the audio thread has played */
+    void flushPlaybackLog();
+
+    /* Records every command posted from now on into log as what the listener did, until it is
+       set to nullptr.  The log is not owned. */
+    void setInteractionLog(InteractionLog *log) { interactionLog = log; }
+
+    /* Problems found while playing are written to logger from now on, until it is set to nullptr.
+       The logger is not owned.  A device error from before is written to it straight away. */
+    void setLogger(Logger *newLogger);
+
+    /* Starts counting glitches for a new trial; the first device start after this is not a restart,
+       and neither is any start() after stop().  Call while the player is stopped. */
+    void startCountingGlitches();
+
+    /* the glitches since the last call or startCountingGlitches() */
+    PlaybackGlitches takeGlitches();
+
+    /* samples played of a stimulus of the current set since the last call, pauses excluded */
+    int64 takeListenedSamples(int stimulus) { return engine.takeListenedSamples(stimulus); }
+
+    /* the ended auditions of the current set, oldest first */
+    bool popAudition(Audition &audition);
+
+    /* true if auditions were dropped since the last call; the listened samples are still complete */
+    bool takeAuditionsLost() { return engine.takeAuditionsLost(); }
+
+    /* callback load, xruns and switch latencies, as of the last updateDiagnostics() */
+    PlaybackDiagnostics &getDiagnostics() { return diagnostics; }
+
+    /* takes in what the audio thread and the device measured since the last call */
+    void updateDiagnostics();
+
+    /* background thread that keeps streamed stimuli filled */
+    TimeSliceThread &getStreamingThread() { return streamingThread; }
+
+    /* decoded stimuli kept across trials */
+    StimulusCache &getStimulusCache() { return stimulusCache; }
 
     void setVideoFile(File &file) { videoFile = &file; }
 
@@ -102,21 +173,52 @@ public:
         return audioDeviceManager;
     }
 
+    /* the current device if it is the null device, for capturing what was played */
+    NullAudioIODevice *getNullDevice() {
+        return dynamic_cast<NullAudioIODevice *>(audioDeviceManager.getCurrentAudioDevice());
+    }
+
 
 private:
-    int currentSample;
-    int totalSamples;
-    int startSample;
-    int endSample;
-    bool playInLoop;
-    int currentStimulus;
-    int nextStimulus;
-    volatile bool playerRunning;
-    volatile bool playerPaused;
-    int channelCount;
+    void postCommand(PlayerCommand::Type type, int64 value);
+
+    /* moves the ended auditions out of the engine's queue before it can fill up */
+    void flushAuditions();
+
+    /* adds the command, as posted by the listener, to the interaction log */
+    void recordInteraction(const PlayerCommand &command);
+
+    /* keeps the video in step with the audio, on the message thread */
+    void timerCallback() override;
+
+    int64 totalSamples;
+    std::atomic<bool> playerRunning;
+    int64 reportedAudioThreadAllocations;
+
+    /* the device independent part of the callback */
+    PlaybackEngine engine;
+    uint32 postedCommands;      // message thread
+    bool requestedPaused;       // message thread
+    PlaybackLog *playbackLog;   // message thread
+    Array <Audition> auditions;         // message thread, taken from the engine but not popped yet
+    InteractionLog *interactionLog;     // message thread
+    Logger *logger;                     // message thread
+    String deviceError;                 // message thread
+    PlaybackDiagnostics diagnostics;    // message thread
+    int lastXRunCount;          // message thread
+
+    /* glitches, counted on the audio thread */
+    std::atomic<int> glitchXRuns;
+    std::atomic<int> glitchRestarts;
+    std::atomic<bool> startedSinceCounting;
+    std::atomic<bool> stoppedByPlayer;      // from stop() until start() has added the callback again
+    AudioIODevice *runningDevice;   // audio thread, set before the device starts
+    int runningDeviceXRuns;         // audio thread
 
     AudioDeviceManager audioDeviceManager;
-    OwnedArray <AudioBuffer<float>> audioStimData;
+    NullAudioIODeviceType *nullDeviceType;  // owned by audioDeviceManager
+    TimeSliceThread streamingThread;
+    StimulusCache stimulusCache;
 
     VideoComponent videoComponent;
     File *videoFile;
@@ -0,0 +1,187 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "AudioThreadGuard.h"
+#include <atomic>
+#include <cstdlib>
+
+#if LT_COUNT_AUDIO_THREAD_ALLOCATIONS
+
+#if JUCE_MAC
+#include <malloc/malloc.h>
+#include <mach/mach.h>
+#elif JUCE_WINDOWS && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+/* The threads inside a section, by id.  A thread_local flag would be simpler, but on macOS the
+   first access to one from a thread allocates, which must not happen inside the allocator. */
+enum {
+    maxAudioThreads = 8
+};
+static std::atomic <Thread::ThreadID> audioThreads[maxAudioThreads];
+static int audioThreadDepths[maxAudioThreads];          // each only touched by the thread in its slot
+static std::atomic <int64> audioThreadAllocations(0);
+
+static void noteAllocatorCall() {
+    const Thread::ThreadID self = Thread::getCurrentThreadId();
+    for (int i = 0; i < maxAudioThreads; i++) {
+        if (audioThreads[i].load(std::memory_order_relaxed) == self) {
+            audioThreadAllocations.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+#if JUCE_LINUX
+
+/* the executable's definitions take the place of the C library's; these are its own entry points */
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+extern "C" void __libc_free(void *p);
+
+extern "C" void *malloc(size_t size) noexcept {
+    noteAllocatorCall();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept {
+    noteAllocatorCall();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) noexcept {
+    noteAllocatorCall();
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void *p) noexcept {
+    if (p != nullptr) {
+        noteAllocatorCall();
+    }
+    __libc_free(p);
+}
+
+static bool installAllocatorHooks() {
+    return true;
+}
+
+#elif JUCE_MAC
+
+static void *(*zoneMalloc)(malloc_zone_t *, size_t);
+static void *(*zoneCalloc)(malloc_zone_t *, size_t, size_t);
+static void *(*zoneRealloc)(malloc_zone_t *, void *, size_t);
+static void (*zoneFree)(malloc_zone_t *, void *);
+
+static void *countingMalloc(malloc_zone_t *zone, size_t size) {
+    noteAllocatorCall();
+    return zoneMalloc(zone, size);
+}
+
+static void *countingCalloc(malloc_zone_t *zone, size_t count, size_t size) {
+    noteAllocatorCall();
+    return zoneCalloc(zone, count, size);
+}
+
+static void *countingRealloc(malloc_zone_t *zone, void *p, size_t size) {
+    noteAllocatorCall();
+    return zoneRealloc(zone, p, size);
+}
+
+static void countingFree(malloc_zone_t *zone, void *p) {
+    if (p != nullptr) {
+        noteAllocatorCall();
+    }
+    zoneFree(zone, p);
+}
+
+static bool installAllocatorHooks() {
+    /* malloc() goes to the first registered zone; malloc_default_zone() may only forward to it */
+    vm_address_t *zones = nullptr;
+    unsigned int numZones = 0;
+    if (malloc_get_all_zones(mach_task_self(), nullptr, &zones, &numZones) != KERN_SUCCESS || numZones == 0)
+        return false;
+
+    malloc_zone_t *zone = reinterpret_cast<malloc_zone_t *>(zones[0]);
+    zoneMalloc = zone->malloc;
+    zoneCalloc = zone->calloc;
+    zoneRealloc = zone->realloc;
+    zoneFree = zone->free;
+
+    /* the zone's functions are kept in read-only memory */
+    vm_protect(mach_task_self(), (vm_address_t) zone, sizeof(malloc_zone_t), 0, VM_PROT_READ | VM_PROT_WRITE);
+    zone->malloc = countingMalloc;
+    zone->calloc = countingCalloc;
+    zone->realloc = countingRealloc;
+    zone->free = countingFree;
+    vm_protect(mach_task_self(), (vm_address_t) zone, sizeof(malloc_zone_t), 0, VM_PROT_READ);
+    return true;
+}
+
+#elif JUCE_WINDOWS && defined(_DEBUG)
+
+static int countingAllocHook(int, void *, size_t, int blockType, long, const unsigned char *, int) {
+    /* the CRT's own blocks are left out, as it allocates them from inside the hook's callers */
+    if (blockType != _CRT_BLOCK) {
+        noteAllocatorCall();
+    }
+    return TRUE;
+}
+
+static bool installAllocatorHooks() {
+    _CrtSetAllocHook(countingAllocHook);
+    return true;
+}
+
+#else
+
+static bool installAllocatorHooks() {
+    return false;
+}
+
+#endif
+
+static const bool allocatorHooked = installAllocatorHooks();
+
+ScopedAudioThreadSection::ScopedAudioThreadSection() :
+        slot(-1) {
+    ignoreUnused(allocatorHooked);
+
+    /* a nested section finds the slot of the one around it */
+    const Thread::ThreadID self = Thread::getCurrentThreadId();
+    for (int i = 0; i < maxAudioThreads && slot < 0; i++) {
+        if (audioThreads[i].load(std::memory_order_relaxed) == self) {
+            slot = i;
+        }
+    }
+    for (int i = 0; i < maxAudioThreads && slot < 0; i++) {
+        Thread::ThreadID empty = nullptr;
+        if (audioThreads[i].compare_exchange_strong(empty, self)) {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0) {
+        ++audioThreadDepths[slot];
+    }
+}
+
+ScopedAudioThreadSection::~ScopedAudioThreadSection() {
+    if (slot >= 0 && --audioThreadDepths[slot] == 0) {
+        audioThreads[slot].store(nullptr);
+    }
+}
+
+int64 getAudioThreadAllocationCount() {
+    return audioThreadAllocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+int64 getAudioThreadAllocationCount() {
+    return 0;
+}
+
+#endif
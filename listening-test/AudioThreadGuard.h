@@ -0,0 +1,42 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef AUDIO_THREAD_GUARD_H
+#define AUDIO_THREAD_GUARD_H
+
+#include <JuceHeader.h>
+
+/* Counting is on in debug builds; the benchmark turns it on in its release build too */
+#ifndef LT_COUNT_AUDIO_THREAD_ALLOCATIONS
+#define LT_COUNT_AUDIO_THREAD_ALLOCATIONS JUCE_DEBUG
+#endif
+
+/**
+    Debug-build check that the audio callback does not allocate.  While a ScopedAudioThreadSection
+    is alive, every call that thread makes to malloc, calloc, realloc or free is counted, which
+    covers operator new and delete as well as HeapBlock and AudioBuffer.  The allocator is hooked
+    by interposing the functions on Linux, by patching the default malloc zone on macOS and with
+    the CRT allocation hook in Windows debug builds; elsewhere nothing is counted.
+    Compiles to nothing unless LT_COUNT_AUDIO_THREAD_ALLOCATIONS is set.
+*/
+class ScopedAudioThreadSection {
+public:
+#if LT_COUNT_AUDIO_THREAD_ALLOCATIONS
+    ScopedAudioThreadSection();
+
+    ~ScopedAudioThreadSection();
+
+private:
+    int slot;       // -1 if there were more audio threads than slots
+#else
+    ScopedAudioThreadSection() {}
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedAudioThreadSection);
+};
+
+/* Number of allocator calls made inside a ScopedAudioThreadSection so far; always 0 when counting is off */
+int64 getAudioThreadAllocationCount();
+
+#endif /* AUDIO_THREAD_GUARD_H */
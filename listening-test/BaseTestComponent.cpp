@@ -54,6 +54,7 @@ void BaseTestComponent::sliderValueChanged(Slider *s) {
             Trial *pTrial = testLauncher.getCurrentTrial();
             if (pTrial != NULL) {
                 pTrial->responsesMoved.set(i, true);
+                testLauncher.recordInteraction(InteractionEvent::score, pTrial->filesOrder[i], s->getValue());
             }
         }
     }
@@ -145,8 +146,17 @@ void BaseTestComponent::handleChangeTrialRequest(int newTrialIndex) {
 
     /* save results if the session is complete */
     if (!shouldContinue) {
-        AlertWindow::showMessageBox(MessageBoxIconType::InfoIcon, "Your results have been recorded.",
-                                    "Thanks for listening today.");
+        /* they are written in the background; make sure they are on the disk before saying so.
+           Errors taken here are not announced again by the change message. */
+        testLauncher.waitForResults();
+        const String errors = testLauncher.getResultsWriter().takeErrors();
+        if (errors.isNotEmpty()) {
+            AlertWindow::showMessageBox(MessageBoxIconType::WarningIcon, "Your results could not be saved",
+                                        errors + "\n\nPlease tell the person running the test.");
+        } else {
+            AlertWindow::showMessageBox(MessageBoxIconType::InfoIcon, "Your results have been recorded.",
+                                        "Thanks for listening today.");
+        }
         testFinished = true;
         sendChangeMessage();
     }
@@ -0,0 +1,118 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "Crossfader.h"
+
+Crossfader::Crossfader() :
+        fadeLength(0),
+        numVoices(0) {
+}
+
+void Crossfader::prepare(double sampleRate, double fadeMs, crossfadeShapeEnum shape) {
+    fadeLength = jmax(0, roundToInt(fadeMs * sampleRate / 1000.0));
+    fadeInGains.malloc((size_t) jmax(1, fadeLength));
+    fadeOutGains.malloc((size_t) jmax(1, fadeLength));
+    fillGains(fadeInGains, fadeOutGains, fadeLength, shape);
+
+    reset(numVoices > 0 ? voices[0].stimulus : -1);
+}
+
+void Crossfader::fillGains(float *fadeIn, float *fadeOut, int length, crossfadeShapeEnum shape) {
+    /* sampled at the middle of each sample, so that the fade-out table is the fade-in table reversed */
+    for (int i = 0; i < length; i++) {
+        const double x = (i + 0.5) / length;
+        double gain;
+        switch (shape) {
+            case CROSSFADE_SHAPE_EQUAL_POWER:
+                gain = std::sin(0.5 * MathConstants<double>::pi * x);
+                break;
+            case CROSSFADE_SHAPE_RAISED_COSINE:
+                gain = 0.5 - 0.5 * std::cos(MathConstants<double>::pi * x);
+                break;
+            default:
+                gain = x;
+                break;
+        }
+        fadeIn[i] = (float) gain;
+    }
+    for (int i = 0; i < length; i++) {
+        fadeOut[i] = fadeIn[length - 1 - i];
+    }
+}
+
+void Crossfader::reset(int stimulus) {
+    numVoices = 0;
+    if (stimulus >= 0) {
+        voices[0].stimulus = stimulus;
+        voices[0].position = fadeLength;
+        voices[0].fadingIn = true;
+        numVoices = 1;
+    }
+}
+
+void Crossfader::switchTo(int stimulus) {
+    if (fadeLength == 0 || numVoices == 0) {
+        reset(stimulus);
+        return;
+    }
+
+    /* the voice playing now fades out from its present gain: fadeOut[n - 1 - p] == fadeIn[p] */
+    Voice &current = voices[0];
+    current.position = jmax(0, fadeLength - 1 - current.position);
+    current.fadingIn = false;
+
+    /* make room by dropping the quietest of the fading voices */
+    if (numVoices == maxVoices) {
+        int quietest = 1;
+        for (int i = 2; i < numVoices; i++) {
+            if (voices[i].position > voices[quietest].position)
+                quietest = i;
+        }
+        voices[quietest] = voices[--numVoices];
+    }
+
+    voices[numVoices++] = voices[0];
+    voices[0].stimulus = stimulus;
+    voices[0].position = 0;
+    voices[0].fadingIn = true;
+
+    /* a stimulus switched back to does not also keep fading out */
+    for (int i = 1; i < numVoices; i++) {
+        if (voices[i].stimulus == stimulus) {
+            voices[0].position = jmax(0, fadeLength - 1 - voices[i].position);
+            voices[i] = voices[--numVoices];
+            break;
+        }
+    }
+}
+
+void Crossfader::mixVoice(int index, AudioBuffer<float> &dest, const AudioBuffer<float> &source, int numChannels,
+                          int numSamples) const {
+    const Voice &voice = voices[index];
+    const int numFading = jlimit(0, numSamples, fadeLength - voice.position);
+    const float *gains = (voice.fadingIn ? fadeInGains.get() : fadeOutGains.get()) + voice.position;
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        float *d = dest.getWritePointer(ch);
+        const float *s = source.getReadPointer(ch);
+
+        if (numFading > 0) {
+            FloatVectorOperations::addWithMultiply(d, s, gains, numFading);
+        }
+
+        /* a fade-in that finishes inside this block carries on at unity; a fade-out is silent */
+        if (voice.fadingIn && numSamples > numFading) {
+            FloatVectorOperations::add(d + numFading, s + numFading, numSamples - numFading);
+        }
+    }
+}
+
+void Crossfader::advance(int numSamples) {
+    for (int i = numVoices; --i >= 0;) {
+        voices[i].position = jmin(fadeLength, voices[i].position + numSamples);
+        if (!voices[i].fadingIn && voices[i].position >= fadeLength) {
+            voices[i] = voices[--numVoices];
+        }
+    }
+}
@@ -0,0 +1,69 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef CROSSFADER_H
+#define CROSSFADER_H
+
+#include <JuceHeader.h>
+#include "PlaybackSettings.h"
+
+/**
+    Gain envelopes for switching between stimuli.  The stimulus switched to fades in while
+    every stimulus switched away from fades out from the gain it had at the moment of the
+    switch, so switching again in the middle of a fade never jumps.  Fades last a fixed time
+    whatever the device block size, and the gains come from tables built in prepare(), so
+    nothing is allocated or computed per sample on the audio thread.
+*/
+class Crossfader {
+public:
+    struct Voice {
+        int stimulus;
+        int position;   // samples into the fade; fade-in voices at fadeLength play at unity
+        bool fadingIn;
+    };
+
+    Crossfader();
+
+    /* Builds the gain tables; call while the audio callback is stopped.  A zero duration
+       switches stimuli without a fade. */
+    void prepare(double sampleRate, double fadeMs, crossfadeShapeEnum shape);
+
+    /* Fills length-sample fade-in and fade-out gain tables of the given shape */
+    static void fillGains(float *fadeIn, float *fadeOut, int length, crossfadeShapeEnum shape);
+
+    /* Plays stimulus at unity straight away and drops all fades; -1 for silence */
+    void reset(int stimulus);
+
+    void switchTo(int stimulus);
+
+    int getNumVoices() const { return numVoices; }
+
+    const Voice &getVoice(int index) const { return voices[index]; }
+
+    /* True if the voice plays at unity gain */
+    bool isUnity(int index) const { return voices[index].fadingIn && voices[index].position >= fadeLength; }
+
+    /* Adds numSamples of source, already read for the voice, into dest with the voice's gains */
+    void mixVoice(int index, AudioBuffer<float> &dest, const AudioBuffer<float> &source, int numChannels,
+                  int numSamples) const;
+
+    /* Moves the fades on by numSamples and drops the voices that have faded out */
+    void advance(int numSamples);
+
+private:
+    enum {
+        maxVoices = 8
+    };
+
+    int fadeLength;
+    HeapBlock<float> fadeInGains;
+    HeapBlock<float> fadeOutGains;
+
+    Voice voices[maxVoices];  // the voice faded in or playing is always first
+    int numVoices;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Crossfader);
+};
+
+#endif /* CROSSFADER_H */
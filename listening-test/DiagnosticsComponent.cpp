@@ -0,0 +1,110 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "DiagnosticsComponent.h"
+
+//==============================================================================
+DiagnosticsComponent::DiagnosticsComponent(AudioPlayer &player) :
+        audioPlayer(player),
+        currentLoad(0.0) {
+    addAndMakeVisible(&resetButton);
+    resetButton.setButtonText("Reset");
+    resetButton.addListener(this);
+    resetButton.setColour(ComboBox::outlineColourId, juce::Colour(0.0f, 0.0f, 0.0f, 0.0f));
+
+    setSize(520, 560);
+    startTimer(250);
+}
+
+DiagnosticsComponent::~DiagnosticsComponent() {
+    stopTimer();
+}
+
+void DiagnosticsComponent::timerCallback() {
+    audioPlayer.updateDiagnostics();
+    currentLoad = audioPlayer.isRunning() ? audioPlayer.getDiagnostics().takeRecentLoad() : 0.0;
+    repaint();
+}
+
+void DiagnosticsComponent::buttonClicked(Button *b) {
+    if (b == &resetButton) {
+        audioPlayer.updateDiagnostics();
+        audioPlayer.getDiagnostics().reset();
+        repaint();
+    }
+}
+
+//==============================================================================
+void DiagnosticsComponent::paint(Graphics &g) {
+    const PlaybackDiagnostics &diagnostics = audioPlayer.getDiagnostics();
+    g.fillAll(Colours::darkgrey);
+
+    const String lines[] = {
+            String::formatted("Callback load: %.1f%% now, %.1f%% mean, %.1f%% peak", currentLoad * 100.0,
+                              diagnostics.getMeanLoad() * 100.0, diagnostics.getPeakLoad() * 100.0),
+            String::formatted("Callbacks: %lld, over their block: %lld, late: %lld",
+                              (long long) diagnostics.getNumCallbacks(), (long long) diagnostics.getOverruns(),
+                              (long long) diagnostics.getLateCallbacks()),
+            diagnostics.getDeviceReportsXRuns() ? "Device xruns: " + String(diagnostics.getDeviceXRuns())
+                                                : String("Device xruns: not reported by this device"),
+            String::formatted("Output latency: %.1f ms", diagnostics.getOutputLatencyMs())
+    };
+
+    g.setColour(Colours::white);
+    g.setFont(Font(15.0f));
+    int y = 10;
+    for (const String &line : lines) {
+        g.drawText(line, 10, y, getWidth() - 20, 20, Justification::centredLeft);
+        y += 22;
+    }
+
+    const int histogramHeight = (getHeight() - y - 50) / 3;
+    Rectangle<int> area(10, y + 10, getWidth() - 20, histogramHeight - 10);
+    paintHistogram(g, diagnostics.getSwitchLatencyHistogram(), "Click to new stimulus heard", "ms", area);
+    area.translate(0, histogramHeight);
+    paintHistogram(g, diagnostics.getCommandLatencyHistogram(), "Click to audio thread", "ms", area);
+    area.translate(0, histogramHeight);
+    paintHistogram(g, diagnostics.getLoadHistogram(), "Callback load", "%", area);
+}
+
+void DiagnosticsComponent::paintHistogram(Graphics &g, const Histogram &histogram, const String &title,
+                                          const String &unit, Rectangle<int> area) {
+    g.setColour(Colours::white);
+    g.drawText(title + String::formatted(": %lld, mean %.2f %s, max %.2f %s", (long long) histogram.getTotal(),
+                                         histogram.getMean(), unit.toRawUTF8(), histogram.getMax(),
+                                         unit.toRawUTF8()),
+               area.removeFromTop(20), Justification::centredLeft);
+
+    int64 largest = 1;
+    for (int i = 0; i < histogram.getNumBuckets(); i++) {
+        largest = jmax(largest, histogram.getCount(i));
+    }
+
+    const int rowHeight = jmax(1, area.getHeight() / histogram.getNumBuckets());
+    g.setFont(Font(12.0f));
+    for (int i = 0; i < histogram.getNumBuckets(); i++) {
+        Rectangle<int> row = area.removeFromTop(rowHeight);
+        g.setColour(Colours::lightgrey);
+        g.drawText(histogram.getBucketName(i) + " " + unit, row.removeFromLeft(80), Justification::centredRight);
+        g.drawText(String(histogram.getCount(i)), row.removeFromRight(70), Justification::centredLeft);
+
+        row.removeFromLeft(6);
+        const int width = (int) (row.getWidth() * histogram.getCount(i) / largest);
+        g.setColour(Colours::orange);
+        g.fillRect(row.getX(), row.getY() + 1, width, jmax(1, row.getHeight() - 2));
+    }
+    g.setFont(Font(15.0f));
+}
+
+void DiagnosticsComponent::resized() {
+    resetButton.setBounds(getWidth() - 90, getHeight() - 34, 80, 24);
+}
+
+//==============================================================================
+DiagnosticsWindow::DiagnosticsWindow(AudioPlayer &player) :
+        DocumentWindow("Playback diagnostics", Colours::darkgrey, DocumentWindow::closeButton) {
+    setUsingNativeTitleBar(true);
+    setContentOwned(new DiagnosticsComponent(player), true);
+    setResizable(true, false);
+}
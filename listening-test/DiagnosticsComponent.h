@@ -0,0 +1,56 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef DIAGNOSTICS_COMPONENT_H
+#define DIAGNOSTICS_COMPONENT_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "AudioPlayer.h"
+
+/**
+    Live view of the PlaybackDiagnostics for test owners: callback load, overruns, late
+    callbacks and xruns, and histograms of the switch latencies and callback loads.
+*/
+class DiagnosticsComponent : public Component,
+                             public Button::Listener,
+                             private Timer {
+public:
+    DiagnosticsComponent(AudioPlayer &player);
+
+    ~DiagnosticsComponent();
+
+    void paint(Graphics &g) override;
+
+    void resized() override;
+
+    void buttonClicked(Button *b) override;
+
+private:
+    void timerCallback() override;
+
+    /* draws one bar per bucket into area, scaled to the largest bucket */
+    void paintHistogram(Graphics &g, const Histogram &histogram, const String &title, const String &unit,
+                        Rectangle<int> area);
+
+    AudioPlayer &audioPlayer;
+    double currentLoad;
+    TextButton resetButton;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiagnosticsComponent);
+};
+
+/**
+    Window holding a DiagnosticsComponent; closing it only hides it.
+*/
+class DiagnosticsWindow : public DocumentWindow {
+public:
+    DiagnosticsWindow(AudioPlayer &player);
+
+    void closeButtonPressed() override { setVisible(false); }
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiagnosticsWindow);
+};
+
+#endif   // DIAGNOSTICS_COMPONENT_H
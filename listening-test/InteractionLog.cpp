@@ -0,0 +1,170 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "InteractionLog.h"
+
+InteractionEventQueue::InteractionEventQueue() :
+        fifo(queueSize) {
+}
+
+bool InteractionEventQueue::push(const InteractionEvent &event) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    events[size1 > 0 ? start1 : start2] = event;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool InteractionEventQueue::pop(InteractionEvent &event) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    event = events[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+InteractionLog::InteractionLog(ResultsReplicator &r, Logger &l) :
+        Thread("Interaction log writer"),
+        replicator(r),
+        logger(l),
+        recording(false),
+        startTicks(0),
+        startMillis(0),
+        currentTrial(-1),
+        eventsLost(0) {
+}
+
+InteractionLog::~InteractionLog() {
+    close();
+}
+
+void InteractionLog::open(const File &file) {
+    close();
+
+    destination = file;
+    startTicks = Time::getHighResolutionTicks();
+    startMillis = Time::currentTimeMillis();
+    queue.reset();
+    eventsLost = 0;
+    recording = true;
+    startThread();
+}
+
+void InteractionLog::close() {
+    if (!recording)
+        return;
+
+    recording = false;
+    stopThread(5000);
+}
+
+String InteractionLog::createSpoolFile() {
+    const String error = ResultsReplicator::prepareSpool(destination);
+    if (error.isNotEmpty())
+        return error;
+
+    spoolFile = ResultsReplicator::getSpoolFile(destination);
+    std::unique_ptr <FileOutputStream> stream(new FileOutputStream(spoolFile));
+    if (stream->failedToOpen())
+        return "Unable to open " + spoolFile.getFullPathName() + ": " + stream->getStatus().getErrorMessage();
+
+    stream->setPosition(0);
+    stream->truncate();
+
+    stream->write("LTIL", 4);
+    stream->writeInt(formatVersion);
+    stream->writeInt64(Time::getHighResolutionTicksPerSecond());
+    stream->writeInt64(startTicks);
+    stream->writeInt64(startMillis);
+    stream->flush();
+    if (stream->getStatus().failed())
+        return "Unable to write " + spoolFile.getFullPathName() + ": " + stream->getStatus().getErrorMessage();
+
+    out = std::move(stream);
+    return String();
+}
+
+void InteractionLog::record(InteractionEvent::Type type, int stimulus, double value, int64 playheadSample,
+                            int64 renderedSamples) {
+    if (!recording)
+        return;
+
+    const int64 now = Time::getHighResolutionTicks();
+    if (eventsLost > 0) {
+        const InteractionEvent lost = {InteractionEvent::lost, currentTrial, -1, (double) eventsLost,
+                                       now - startTicks, playheadSample, renderedSamples};
+        if (!queue.push(lost)) {
+            ++eventsLost;
+            return;
+        }
+        eventsLost = 0;
+    }
+
+    const InteractionEvent event = {type, currentTrial, stimulus, value, now - startTicks, playheadSample,
+                                    renderedSamples};
+    if (!queue.push(event)) {
+        ++eventsLost;
+    }
+}
+
+void InteractionLog::run() {
+    const String error = createSpoolFile();
+    if (error.isNotEmpty()) {
+        logger.logMessage("Listener interactions are not recorded: " + error);
+        return;
+    }
+    replicator.replicate(spoolFile);
+
+    /* copying the whole file after every batch would keep a network share busy */
+    uint32 lastReplicated = Time::getMillisecondCounter();
+    bool unreplicated = false;
+    while (!threadShouldExit()) {
+        wait(100);
+        if (writeQueued()) {
+            unreplicated = true;
+        }
+        if (unreplicated && Time::getMillisecondCounter() - lastReplicated >= (uint32) replicateIntervalMs) {
+            replicator.replicate(spoolFile);
+            lastReplicated = Time::getMillisecondCounter();
+            unreplicated = false;
+        }
+    }
+
+    /* whatever was recorded before close() was called */
+    writeQueued();
+    out.reset();
+    replicator.replicate(spoolFile);
+}
+
+bool InteractionLog::writeQueued() {
+    InteractionEvent event;
+    bool wrote = false;
+    while (queue.pop(event)) {
+        writeEvent(event);
+        wrote = true;
+    }
+
+    if (wrote) {
+        out->flush();
+    }
+    return wrote;
+}
+
+void InteractionLog::writeEvent(const InteractionEvent &event) {
+    out->writeByte((char) event.type);
+    out->writeByte(0);
+    out->writeShort((short) jlimit(-1, 32767, event.stimulus));
+    out->writeInt(event.trial);
+    out->writeInt64(event.ticks);
+    out->writeInt64(event.playheadSample);
+    out->writeInt64(event.renderedSamples);
+    out->writeDouble(event.value);
+}
@@ -0,0 +1,142 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef INTERACTION_LOG_H
+#define INTERACTION_LOG_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ResultsReplicator.h"
+#include <memory>
+
+/**
+    Something the listener did, stamped with Time::getHighResolutionTicks(), which is monotonic,
+    and with the audio clock: where the playhead was and how many samples the engine had rendered.
+    The values of Type are stored in the file, so only ever add to the end.
+*/
+struct InteractionEvent {
+    enum Type {
+        trial = 0,          // a trial's stimuli were installed; value is the sample rate of the positions
+        switchStimulus = 1, // value is the stimulus switched to
+        seek = 2,           // value is the sample the playhead was moved to
+        loopStart = 3,      // value is the sample the loop region now starts at
+        loopEnd = 4,        // value is the sample the loop region now ends at
+        loop = 5,           // value is 1 if looping was turned on, 0 if off
+        pause = 6,
+        resume = 7,
+        score = 8,          // value is the new rating of stimulus, or the preference in an AB test
+        lost = 9            // value is the number of events dropped here because the queue was full
+    };
+
+    Type type;
+    int trial;
+    int stimulus;           // index into the trial's files, -1 if the event is not about one
+    double value;
+    int64 ticks;
+    int64 playheadSample;
+    int64 renderedSamples;
+};
+
+/**
+    Single-producer, single-consumer lock-free queue of InteractionEvents, filled by the message
+    thread and emptied by the thread writing them out.
+*/
+class InteractionEventQueue {
+public:
+    InteractionEventQueue();
+
+    /* Producer side; returns false if the queue is full */
+    bool push(const InteractionEvent &event);
+
+    /* Consumer side; returns false if the queue is empty */
+    bool pop(InteractionEvent &event);
+
+    /* Only while neither side is running */
+    void reset() { fifo.reset(); }
+
+private:
+    enum {
+        queueSize = 4096
+    };
+
+    AbstractFifo fifo;
+    InteractionEvent events[queueSize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InteractionEventQueue);
+};
+
+/**
+    Binary log of a session's InteractionEvents.  The message thread only queues the events; a
+    background thread creates the file in the local results spool, writes the events to it and
+    flushes after every batch, so recording never waits for the disk and a crash loses at most the
+    last fraction of a second.  The ResultsReplicator copies the file to its destination every
+    few seconds while it grows, and once more when it is closed.
+
+    The file starts with a header: the magic "LTIL" and the format version as 32 bits, then the
+    number of ticks per second, and the ticks and the wall-clock time in milliseconds since 1970
+    at which the session began, as 64-bit integers.  Every event follows as a record of
+    recordSize bytes: the type as 8 bits, 8 bits of padding, the stimulus as 16 bits, the trial
+    as 32 bits, the ticks since the session began, the playhead sample and the rendered samples
+    as 64-bit integers and the value as a double.  All values are little-endian.
+*/
+class InteractionLog : private Thread {
+public:
+    /* errors are written to logger */
+    InteractionLog(ResultsReplicator &replicator, Logger &logger);
+
+    ~InteractionLog();
+
+    enum {
+        formatVersion = 1,
+        headerSize = 32,
+        recordSize = 40
+    };
+
+    /* Closes the current log and starts a new one that replaces destination.  The file is
+       created by the writer thread, so this never waits for the disk. */
+    void open(const File &destination);
+
+    /* Writes out the events still queued and closes the file */
+    void close();
+
+    bool isOpen() const { return recording; }
+
+    /* the trial the following events belong to */
+    void setTrial(int newTrial) { currentTrial = newTrial; }
+
+    /* Message thread only; does nothing while no log is open */
+    void record(InteractionEvent::Type type, int stimulus, double value, int64 playheadSample, int64 renderedSamples);
+
+private:
+    void run() override;
+
+    /* Creates the spool file and writes the header.  Returns an empty string on success or the
+       error message. */
+    String createSpoolFile();
+
+    /* writes out what is queued and flushes; returns false if there was nothing */
+    bool writeQueued();
+
+    void writeEvent(const InteractionEvent &event);
+
+    enum {
+        replicateIntervalMs = 10000
+    };
+
+    ResultsReplicator &replicator;
+    Logger &logger;
+
+    File destination;           // set before the writer thread starts
+    File spoolFile;             // writer thread
+    std::unique_ptr <FileOutputStream> out;    // writer thread
+    bool recording;             // message thread
+    int64 startTicks;           // set before the writer thread starts
+    int64 startMillis;
+    int currentTrial;           // message thread
+    InteractionEventQueue queue;
+    int eventsLost;             // message thread, since the last lost event was queued
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InteractionLog);
+};
+
+#endif /* INTERACTION_LOG_H */
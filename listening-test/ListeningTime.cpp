@@ -0,0 +1,82 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "ListeningTime.h"
+
+AuditionQueue::AuditionQueue() :
+        fifo(queueSize) {
+}
+
+bool AuditionQueue::push(const Audition &audition) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    auditions[size1 > 0 ? start1 : start2] = audition;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool AuditionQueue::pop(Audition &audition) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    audition = auditions[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+ListeningTimeCounter::ListeningTimeCounter() :
+        numStimuli(0),
+        current(),
+        auditionOpen(false),
+        auditionsLost(false) {
+}
+
+void ListeningTimeCounter::prepare(int newNumStimuli) {
+    endAudition();
+    numStimuli = newNumStimuli;
+    samples.reset(new std::atomic<int64>[(size_t) jmax(1, numStimuli)]);
+    for (int i = 0; i < numStimuli; i++) {
+        samples[i] = 0;
+    }
+}
+
+void ListeningTimeCounter::add(int stimulus, int64 loopStart, int64 loopEnd, bool looping, int numSamples) {
+    if (stimulus < 0 || stimulus >= numStimuli)
+        return;
+
+    samples[stimulus].fetch_add(numSamples, std::memory_order_relaxed);
+
+    if (!auditionOpen || stimulus != current.stimulus || loopStart != current.loopStart
+        || loopEnd != current.loopEnd || looping != current.looping) {
+        endAudition();
+        const Audition audition = {stimulus, loopStart, loopEnd, looping, 0, Time::getHighResolutionTicks(), 0};
+        current = audition;
+        auditionOpen = true;
+    }
+    current.samples += numSamples;
+}
+
+void ListeningTimeCounter::endAudition() {
+    if (!auditionOpen)
+        return;
+
+    auditionOpen = false;
+    current.endTicks = Time::getHighResolutionTicks();
+    if (!queue.push(current)) {
+        auditionsLost = true;
+    }
+}
+
+int64 ListeningTimeCounter::takeSamples(int stimulus) {
+    if (stimulus < 0 || stimulus >= numStimuli)
+        return 0;
+
+    return samples[stimulus].exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef LISTENING_TIME_H
+#define LISTENING_TIME_H
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+
+/**
+    One stretch of playback of a single stimulus within a single loop region, from the first
+    block rendered to the pause, switch or loop change that ended it.  Ticks are
+    Time::getHighResolutionTicks(), which is monotonic.
+*/
+struct Audition {
+    int stimulus;
+    int64 loopStart;
+    int64 loopEnd;
+    bool looping;
+    int64 samples;      // rendered, so pauses do not count
+    int64 startTicks;
+    int64 endTicks;
+};
+
+/**
+    Single-producer, single-consumer lock-free queue of Auditions, filled by the audio thread
+    and emptied by the message thread.
+*/
+class AuditionQueue {
+public:
+    AuditionQueue();
+
+    /* Producer side; returns false if the queue is full */
+    bool push(const Audition &audition);
+
+    /* Consumer side; returns false if the queue is empty */
+    bool pop(Audition &audition);
+
+private:
+    enum {
+        queueSize = 256
+    };
+
+    AbstractFifo fifo;
+    Audition auditions[queueSize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AuditionQueue);
+};
+
+/**
+    Adds up, on the audio thread, the samples rendered of every stimulus, and splits the
+    playback into Auditions.  A block costs one add into a preallocated counter; the clock is
+    only read when an audition starts or ends.
+*/
+class ListeningTimeCounter {
+public:
+    ListeningTimeCounter();
+
+    /* Allocates and clears the counters for numStimuli stimuli; only while add() is not running */
+    void prepare(int numStimuli);
+
+    /* Audio thread: numSamples samples of stimulus were rendered at the given loop settings */
+    void add(int stimulus, int64 loopStart, int64 loopEnd, bool looping, int numSamples);
+
+    /* Producer side: ends the current audition, if any, because playback stopped or paused */
+    void endAudition();
+
+    /* Consumer side: the samples rendered of stimulus since the last call */
+    int64 takeSamples(int stimulus);
+
+    /* Consumer side; returns false if no ended audition is waiting */
+    bool popAudition(Audition &audition) { return queue.pop(audition); }
+
+    /* True if auditions were dropped because the queue was full, since the last call */
+    bool takeAuditionsLost() { return auditionsLost.exchange(false); }
+
+private:
+    std::unique_ptr<std::atomic<int64>[]> samples;
+    int numStimuli;
+
+    Audition current;   // producer
+    bool auditionOpen;  // producer
+    AuditionQueue queue;
+    std::atomic<bool> auditionsLost;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ListeningTimeCounter);
+};
+
+#endif /* LISTENING_TIME_H */
@@ -0,0 +1,329 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "Loudness.h"
+#include "SampleKernels.h"
+
+const double absoluteGateLufs = -70.0;
+const double relativeGateLu = -10.0;
+const int peakTapsPerPhase = 12;
+const int fingerprintChunkBytes = 65536;
+
+static double getLoudness(double meanSquare) {
+    return -0.691 + 10.0 * std::log10(meanSquare);
+}
+
+//==============================================================================
+LoudnessMeter::LoudnessMeter(int numChannels, double sampleRate) :
+        channelCount(numChannels),
+        hopLength(jmax(1, roundToInt(sampleRate / 10.0))),
+        hopPosition(0),
+        scratchSize(0),
+        peak(0.0f) {
+    /* K-weighting: the BS.1770 high shelf and high pass, derived for the actual sample rate */
+    double K = std::tan(MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+    const double Q = 0.7071752369554196;
+    const double Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    const double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+    shelf.b1 = 2.0 * (K * K - Vh) / a0;
+    shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+    shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+    shelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+    K = std::tan(MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+    const double Qh = 0.5003270373238773;
+    a0 = 1.0 + K / Qh + K * K;
+    highPass.b0 = 1.0;
+    highPass.b1 = -2.0;
+    highPass.b2 = 1.0;
+    highPass.a1 = 2.0 * (K * K - 1.0) / a0;
+    highPass.a2 = (1.0 - K / Qh + K * K) / a0;
+
+    filterState.calloc((size_t) channelCount * 8);
+    hopSums.calloc((size_t) channelCount);
+
+    /* LFE does not count and surrounds count 1.41 times, in WAV order (L R C LFE Ls Rs ...) */
+    const int numSurrounds = (channelCount == 6 || channelCount == 10) ? 2
+                             : (channelCount == 8 || channelCount == 12) ? 4 : 0;
+    for (int ch = 0; ch < channelCount; ch++) {
+        if (numSurrounds > 0 && ch == 3) {
+            channelWeights.add(0.0);
+        } else if (ch >= 4 && ch < 4 + numSurrounds) {
+            channelWeights.add(1.41);
+        } else {
+            channelWeights.add(1.0);
+        }
+    }
+
+    /* true peak: windowed-sinc interpolation between the samples */
+    oversampling = sampleRate < 96000.0 ? 4 : (sampleRate < 192000.0 ? 2 : 1);
+    tapsPerPhase = oversampling > 1 ? peakTapsPerPhase : 1;
+    peakFilter.malloc((size_t) oversampling * tapsPerPhase);
+    const int halfTaps = tapsPerPhase / 2;
+    for (int phase = 0; phase < oversampling; phase++) {
+        float *taps = peakFilter + phase * tapsPerPhase;
+        double sum = 0.0;
+        for (int k = 0; k < tapsPerPhase; k++) {
+            const double distance = k - halfTaps + 1 - (double) phase / oversampling;
+            const double x = distance / (halfTaps + 0.5);
+            const double arg = MathConstants<double>::pi * distance;
+            const double sinc = distance == 0.0 ? 1.0 : std::sin(arg) / arg;
+            const double window = 0.5 + 0.5 * std::cos(MathConstants<double>::pi * jlimit(-1.0, 1.0, x));
+            taps[k] = (float) (sinc * window);
+            sum += sinc * window;
+        }
+        for (int k = 0; k < tapsPerPhase; k++) {
+            taps[k] = (float) (taps[k] / sum);
+        }
+    }
+    peakHistory.setSize(channelCount, jmax(1, tapsPerPhase - 1));
+    peakHistory.clear();
+}
+
+void LoudnessMeter::process(const AudioBuffer<float> &buffer, int numSamples) {
+    const int needed = jmax(hopLength, numSamples + tapsPerPhase - 1);
+    if (scratchSize < needed) {
+        scratch.malloc((size_t) needed);
+        scratchSize = needed;
+    }
+
+    for (int done = 0; done < numSamples;) {
+        const int num = jmin(numSamples - done, hopLength - hopPosition);
+        for (int ch = 0; ch < channelCount; ch++) {
+            filterChannel(ch, buffer.getReadPointer(ch, done), scratch, num);
+            hopSums[ch] += dotProduct(scratch, scratch, num);
+        }
+
+        done += num;
+        hopPosition += num;
+        if (hopPosition == hopLength) {
+            double energy = 0.0;
+            for (int ch = 0; ch < channelCount; ch++) {
+                energy += channelWeights[ch] * hopSums[ch] / hopLength;
+                hopSums[ch] = 0.0;
+            }
+            hopEnergies.add(energy);
+            hopPosition = 0;
+        }
+    }
+
+    for (int ch = 0; ch < channelCount; ch++) {
+        measurePeaks(ch, buffer.getReadPointer(ch), numSamples);
+    }
+}
+
+void LoudnessMeter::filterChannel(int channel, const float *source, float *dest, int numSamples) {
+    double *s = filterState + channel * 8;
+    double x1 = s[0], x2 = s[1], y1 = s[2], y2 = s[3];
+    double z1 = s[4], z2 = s[5], w1 = s[6], w2 = s[7];
+
+    for (int i = 0; i < numSamples; i++) {
+        const double x = source[i];
+        const double y = shelf.b0 * x + shelf.b1 * x1 + shelf.b2 * x2 - shelf.a1 * y1 - shelf.a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+
+        const double w = highPass.b0 * y + highPass.b1 * z1 + highPass.b2 * z2 - highPass.a1 * w1 - highPass.a2 * w2;
+        z2 = z1;
+        z1 = y;
+        w2 = w1;
+        w1 = w;
+        dest[i] = (float) w;
+    }
+
+    s[0] = x1, s[1] = x2, s[2] = y1, s[3] = y2;
+    s[4] = z1, s[5] = z2, s[6] = w1, s[7] = w2;
+}
+
+void LoudnessMeter::measurePeaks(int channel, const float *source, int numSamples) {
+    const Range<float> range(FloatVectorOperations::findMinAndMax(source, numSamples));
+    peak = jmax(peak, -range.getStart(), range.getEnd());
+    if (oversampling == 1)
+        return;
+
+    /* the samples kept from the previous block, followed by this one */
+    const int historyLength = tapsPerPhase - 1;
+    FloatVectorOperations::copy(scratch, peakHistory.getReadPointer(channel), historyLength);
+    FloatVectorOperations::copy(scratch + historyLength, source, numSamples);
+
+    for (int i = 0; i < numSamples; i++) {
+        for (int phase = 0; phase < oversampling; phase++) {
+            const float value = dotProduct(peakFilter + phase * tapsPerPhase, scratch + i, tapsPerPhase);
+            peak = jmax(peak, std::abs(value));
+        }
+    }
+
+    peakHistory.copyFrom(channel, 0, scratch + numSamples, historyLength);
+}
+
+LoudnessInfo LoudnessMeter::getResult() const {
+    LoudnessInfo result;
+    if (peak > 0.0f) {
+        result.truePeakDbtp = 20.0 * std::log10((double) peak);
+    }
+
+    /* 400 ms blocks overlapping by 75%; a stimulus shorter than one block is measured as a whole */
+    Array<double> blocks;
+    for (int i = 3; i < hopEnergies.size(); i++) {
+        blocks.add((hopEnergies[i - 3] + hopEnergies[i - 2] + hopEnergies[i - 1] + hopEnergies[i]) / 4.0);
+    }
+    if (blocks.isEmpty()) {
+        double energy = 0.0;
+        for (int ch = 0; ch < channelCount; ch++) {
+            energy += channelWeights[ch] * hopSums[ch];
+        }
+        for (int i = 0; i < hopEnergies.size(); i++) {
+            energy += hopEnergies[i] * hopLength;
+        }
+        const int length = hopEnergies.size() * hopLength + hopPosition;
+        if (length > 0) {
+            blocks.add(energy / length);
+        }
+    }
+
+    double sum = 0.0;
+    int count = 0;
+    for (int i = 0; i < blocks.size(); i++) {
+        if (blocks[i] > 0.0 && getLoudness(blocks[i]) > absoluteGateLufs) {
+            sum += blocks[i];
+            count++;
+        }
+    }
+    if (count == 0)
+        return result;
+
+    const double relativeGate = getLoudness(sum / count) + relativeGateLu;
+    sum = 0.0;
+    count = 0;
+    for (int i = 0; i < blocks.size(); i++) {
+        if (blocks[i] > 0.0 && getLoudness(blocks[i]) > jmax(absoluteGateLufs, relativeGate)) {
+            sum += blocks[i];
+            count++;
+        }
+    }
+    if (count > 0) {
+        result.integratedLufs = getLoudness(sum / count);
+    }
+    return result;
+}
+
+bool LoudnessMeter::measure(AudioFormatReader &reader, int numChannels, int64 numSamples, LoudnessInfo &result,
+                            const std::function<bool()> &shouldExit) {
+    const int chunkSamples = 65536;
+    LoudnessMeter meter(numChannels, reader.sampleRate);
+    AudioBuffer<float> buffer(numChannels, chunkSamples);
+
+    for (int64 position = 0; position < numSamples; position += chunkSamples) {
+        if (shouldExit && shouldExit())
+            return false;
+
+        const int num = (int) jmin((int64) chunkSamples, numSamples - position);
+        reader.read(&buffer, 0, num, position, true, true);
+        meter.process(buffer, num);
+    }
+
+    result = meter.getResult();
+    return true;
+}
+
+//==============================================================================
+LoudnessCache::LoudnessCache(const File &cacheFile) :
+        file(cacheFile),
+        loaded(false),
+        changed(false) {
+}
+
+bool LoudnessCache::find(const String &fingerprint, LoudnessInfo &result) {
+    const ScopedLock sl(lock);
+    loadIfNeeded();
+    if (!entries.contains(fingerprint))
+        return false;
+
+    result = entries[fingerprint];
+    return true;
+}
+
+void LoudnessCache::add(const String &fingerprint, const LoudnessInfo &info) {
+    const ScopedLock sl(lock);
+    loadIfNeeded();
+    entries.set(fingerprint, info);
+    changed = true;
+}
+
+void LoudnessCache::save() {
+    const ScopedLock sl(lock);
+    if (!changed)
+        return;
+
+    XmlElement cacheXml("loudnessCache");
+    for (HashMap<String, LoudnessInfo>::Iterator i(entries); i.next();) {
+        XmlElement *entry = cacheXml.createNewChildElement("stimulus");
+        entry->setAttribute("fingerprint", i.getKey());
+        /* silence is left out and reads back as minus infinity */
+        if (std::isfinite(i.getValue().integratedLufs)) {
+            entry->setAttribute("loudnessLufs", i.getValue().integratedLufs);
+        }
+        if (std::isfinite(i.getValue().truePeakDbtp)) {
+            entry->setAttribute("truePeakDbtp", i.getValue().truePeakDbtp);
+        }
+    }
+
+    file.getParentDirectory().createDirectory();
+    if (cacheXml.writeTo(file)) {
+        changed = false;
+    }
+}
+
+void LoudnessCache::loadIfNeeded() {
+    if (loaded)
+        return;
+    loaded = true;
+
+    std::unique_ptr <XmlElement> cacheXml(parseXML(file));
+    if (cacheXml == nullptr)
+        return;
+
+    const double silence = -std::numeric_limits<double>::infinity();
+    for (int i = 0; i < cacheXml->getNumChildElements(); i++) {
+        const XmlElement *entry = cacheXml->getChildElement(i);
+        LoudnessInfo info;
+        info.integratedLufs = entry->getDoubleAttribute("loudnessLufs", silence);
+        info.truePeakDbtp = entry->getDoubleAttribute("truePeakDbtp", silence);
+        entries.set(entry->getStringAttribute("fingerprint"), info);
+    }
+}
+
+String LoudnessCache::getFingerprint(const File &file) {
+    /* the modification time catches edits that keep the length and miss the sampled chunks */
+    uint64 hash = 14695981039346656037ULL;
+    const int64 size = file.getSize();
+    const int64 modified = file.getLastModificationTime().toMilliseconds();
+    for (int i = 0; i < 8; i++) {
+        hash = (hash ^ (uint8) (size >> (i * 8))) * 1099511628211ULL;
+    }
+    for (int i = 0; i < 8; i++) {
+        hash = (hash ^ (uint8) (modified >> (i * 8))) * 1099511628211ULL;
+    }
+
+    FileInputStream stream(file);
+    if (stream.failedToOpen())
+        return String();
+
+    HeapBlock<uint8> chunk((size_t) fingerprintChunkBytes);
+    const int64 starts[] = {0, jmax((int64) 0, size / 2 - fingerprintChunkBytes / 2),
+                            jmax((int64) 0, size - fingerprintChunkBytes)};
+    for (int64 start : starts) {
+        stream.setPosition(start);
+        const int num = stream.read(chunk, fingerprintChunkBytes);
+        for (int i = 0; i < num; i++) {
+            hash = (hash ^ chunk[i]) * 1099511628211ULL;
+        }
+    }
+
+    return String::toHexString((int64) hash);
+}
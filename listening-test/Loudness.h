@@ -0,0 +1,107 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <JuceHeader.h>
+#include <functional>
+
+/**
+    Integrated loudness (LUFS) and true peak (dBTP) of a stimulus.  Silence has a loudness
+    of minus infinity.
+*/
+struct LoudnessInfo {
+    LoudnessInfo() : integratedLufs(-std::numeric_limits<double>::infinity()),
+                     truePeakDbtp(-std::numeric_limits<double>::infinity()) {};
+
+    double integratedLufs;
+    double truePeakDbtp;
+};
+
+
+/**
+    ITU-R BS.1770-4 loudness meter: K-weighting, 400 ms blocks every 100 ms, channel weights
+    for 5.1 and larger layouts, absolute and relative gating, and a true peak measured on a
+    4 times (2 times above 96 kHz) oversampled signal.  The block energies and the
+    oversampling filter use the vectorized dot product of SampleKernels.
+*/
+class LoudnessMeter {
+public:
+    LoudnessMeter(int numChannels, double sampleRate);
+
+    /* Feeds numSamples samples of every channel */
+    void process(const AudioBuffer<float> &buffer, int numSamples);
+
+    LoudnessInfo getResult() const;
+
+    /* Measures numSamples samples read from reader.  Returns false if shouldExit returned true first. */
+    static bool measure(AudioFormatReader &reader, int numChannels, int64 numSamples, LoudnessInfo &result,
+                        const std::function<bool()> &shouldExit = nullptr);
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void filterChannel(int channel, const float *source, float *dest, int numSamples);
+
+    void measurePeaks(int channel, const float *source, int numSamples);
+
+    const int channelCount;
+    const int hopLength;        // samples in 100 ms
+    Biquad shelf;
+    Biquad highPass;
+    HeapBlock<double> filterState;  // 4 values per channel and stage
+    Array<double> channelWeights;
+
+    Array<double> hopEnergies;  // weighted mean square of every complete 100 ms hop
+    HeapBlock<double> hopSums;
+    int hopPosition;
+
+    int oversampling;
+    int tapsPerPhase;
+    HeapBlock<float> peakFilter;    // tapsPerPhase coefficients for each phase
+    AudioBuffer<float> peakHistory; // the last samples of every channel, before the next block
+    HeapBlock<float> scratch;
+    int scratchSize;
+    float peak;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter);
+};
+
+
+/**
+    Loudness measurements kept on disk between sessions, keyed by a fingerprint of the file's
+    size, modification time and contents, so that a file renamed or used by another test is not
+    measured again.  A copy is only recognised if it kept the modification time.  Thread-safe.
+*/
+class LoudnessCache {
+public:
+    explicit LoudnessCache(const File &cacheFile);
+
+    bool find(const String &fingerprint, LoudnessInfo &result);
+
+    void add(const String &fingerprint, const LoudnessInfo &info);
+
+    /* Writes the cache file if anything was added */
+    void save();
+
+    /* FNV-1a hash of the size and modification time of the file and of 64 KiB taken from its
+       start, middle and end */
+    static String getFingerprint(const File &file);
+
+private:
+    void loadIfNeeded();
+
+    const File file;
+    CriticalSection lock;
+    HashMap <String, LoudnessInfo> entries;
+    bool loaded;
+    bool changed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessCache);
+};
+
+#endif /* LOUDNESS_H */
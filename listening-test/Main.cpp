@@ -4,6 +4,8 @@
 //    Copyright(C) 2017  Netflix, Inc.
 
 #include "MainComponent.h"
+#include "PlaybackRenderer.h"
+#include <iostream>
 
 
 class ListeningTestApplication : public JUCEApplication {
@@ -11,7 +13,25 @@ public:
     ListeningTestApplication() {}
     ~ListeningTestApplication() {}
 
-    void initialise(const String & /*commandLine*/) override {
+    void initialise(const String &commandLine) override {
+        /* --render <results file> <output directory> renders the playback logs of a results file and quits */
+        StringArray args;
+        args.addTokens(commandLine, true);
+        if (args[0] == "--render") {
+            PlaybackRenderer renderer;
+            const String error(renderer.renderResults(File::getCurrentWorkingDirectory().getChildFile(args[1].unquoted()),
+                                                      File::getCurrentWorkingDirectory().getChildFile(args[2].unquoted())));
+            for (int i = 0; i < renderer.getWarnings().size(); i++) {
+                std::cout << renderer.getWarnings()[i] << std::endl;
+            }
+            if (error.isNotEmpty()) {
+                std::cerr << error << std::endl;
+            }
+            setApplicationReturnValue(error.isEmpty() ? 0 : 1);
+            quit();
+            return;
+        }
+
         mainDocumentWindow.reset(new MainDocumentWindow(getApplicationName() + " v" + ProjectInfo::versionString));
     }
 
@@ -35,7 +35,8 @@ const String hotkeysText =
 "           shift + c : clear loop end\n"
 "                home : restart playback\n"
 "         right-arrow : advance loop to next segment\n"
-"          left-arrow : retreat loop to previous segment";
+"          left-arrow : retreat loop to previous segment\n"
+"        ctrl/cmd + d : show playback diagnostics";
 
 //==============================================================================
 MainComponent::MainComponent() :
@@ -66,6 +67,12 @@ MainComponent::MainComponent() :
     surveyComponent.addChangeListener(this);
     addChildComponent(surveyComponent);
 
+    testLauncher.getResultsWriter().addChangeListener(this);
+    testLauncher.getResultsReplicator().addChangeListener(this);
+    addAndMakeVisible(resultsStatusLabel);
+    resultsStatusLabel.setFont(Font(12.0f));
+    resultsStatusLabel.setColour(Label::textColourId, Colours::lightgrey);
+
     // Create boxes for test controls & playback controls
     addAndMakeVisible(&testBorder);
     testBorder.setText("  Test Controls  ");
@@ -177,10 +184,17 @@ MainComponent::MainComponent() :
     audioPlayer.start();
 
     setSize(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+
+    if (audioPlayer.getDeviceError().isNotEmpty()) {
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Audio device error", audioPlayer.getDeviceError(),
+                                         "OK", this);
+    }
 }
 
 
 MainComponent::~MainComponent() {
+    testLauncher.getResultsWriter().removeChangeListener(this);
+    testLauncher.getResultsReplicator().removeChangeListener(this);
     audioPlayer.stop();
 }
 
@@ -217,6 +231,8 @@ void MainComponent::resized() {
     loadTestButton.setBounds(rightmostButtonX - BUTTON_W * 2.2, audioSetupButton.getY(), BUTTON_W, BUTTON_H);
     manageTestsButton.setBounds(rightmostButtonX - BUTTON_W * 3.3, audioSetupButton.getY(), BUTTON_W, BUTTON_H);
     showHotkeysButton.setBounds(rightmostButtonX - BUTTON_W * 4.4, audioSetupButton.getY(), BUTTON_W, BUTTON_H);
+    resultsStatusLabel.setBounds(testBorder.getX(), audioSetupButton.getY(),
+                                 showHotkeysButton.getX() - testBorder.getX() - 10, BUTTON_H);
 
     // Playback controls
     // slider row
@@ -240,7 +256,8 @@ void MainComponent::resized() {
 }
 
 void MainComponent::handlePlaybackSliderChange() {
-    float minPlaybackLoopLength = 0;
+    /* double, since a float slider position is too coarse to address every sample of a long programme */
+    double minPlaybackLoopLength = 0;
     if (testLauncher.getLengthInSamples() > 0) {
         minPlaybackLoopLength =
                 SLIDER_MAXVALUE * 24000.0 / testLauncher.getLengthInSamples(); // 500ms according to MUSHRA spec
@@ -248,12 +265,12 @@ void MainComponent::handlePlaybackSliderChange() {
     if (lockLoop) {
         minPlaybackLoopLength = playbackSliderMax - playbackSliderMin;
     }
-    const float maxMinPos = SLIDER_MAXVALUE - minPlaybackLoopLength;
-    const float minMaxPos = minPlaybackLoopLength;
-    float playbackPos = SLIDER_MAXVALUE * audioPlayer.getCurrentPosition();
-    float newMinPos = playbackSlider.getMinValue();
-    float newMaxPos = playbackSlider.getMaxValue();
-    float newPlaybackPos = playbackSlider.getValue();
+    const double maxMinPos = SLIDER_MAXVALUE - minPlaybackLoopLength;
+    const double minMaxPos = minPlaybackLoopLength;
+    double playbackPos = SLIDER_MAXVALUE * audioPlayer.getCurrentPosition();
+    double newMinPos = playbackSlider.getMinValue();
+    double newMaxPos = playbackSlider.getMaxValue();
+    double newPlaybackPos = playbackSlider.getValue();
 
     bool minChanged = newMinPos != playbackSliderMin;
     bool maxChanged = newMaxPos != playbackSliderMax;
@@ -344,12 +361,19 @@ void MainComponent::saveAudioDeviceSettings() {
     }
 
     audioPlayer.resetCurrentDevice(audioDeviceSettingsFile);
-    if ((audioPlayer.getOutputChannels() < testLauncher.getInputChannels()) && testLauncher.getInputChannels() != 0) {
+    if (audioPlayer.getDeviceError().isNotEmpty()) {
+        AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Audio device error", audioPlayer.getDeviceError(), "OK",
+                                    this);
+    }
+    if (testLauncher.reloadIfSampleRateChanged() && testLauncher.lastError.isNotEmpty()) {
+        AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error occurred", testLauncher.lastError, "OK", this);
+    }
+    if (audioPlayer.getNumOutputChannels() < testLauncher.getRequiredOutputChannels()) {
         AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Error occurred",
                                     "Current test requires a device with at least " +
-                                    String(testLauncher.getInputChannels()) +
+                                    String(testLauncher.getRequiredOutputChannels()) +
                                     " ouptut channels; the one you selected only has " +
-                                    audioPlayer.getOutputChannels().toString(10), "OK", this);
+                                    String(audioPlayer.getNumOutputChannels()), "OK", this);
     }
 
 }
@@ -425,7 +449,9 @@ void MainComponent::runContinueTestSelector() {
 }
 
 bool MainComponent::keyPressed(const KeyPress &key, Component *c) {
-    if (key.isKeyCode(key.spaceKey)) {
+    if (key == KeyPress('d', ModifierKeys::commandModifier, 0)) {
+        toggleDiagnostics();
+    } else if (key.isKeyCode(key.spaceKey)) {
         togglePlayback();
     } else if (key.isKeyCode(key.rightKey)) {
         buttonListener.buttonClicked(&forwardButton);
@@ -454,6 +480,17 @@ bool MainComponent::keyPressed(const KeyPress &key, Component *c) {
     return true;
 }
 
+void MainComponent::toggleDiagnostics() {
+    if (diagnosticsWindow == nullptr) {
+        diagnosticsWindow.reset(new DiagnosticsWindow(audioPlayer));
+        diagnosticsWindow->centreAroundComponent(this, diagnosticsWindow->getWidth(), diagnosticsWindow->getHeight());
+    }
+    diagnosticsWindow->setVisible(!diagnosticsWindow->isVisible());
+    if (diagnosticsWindow->isVisible()) {
+        diagnosticsWindow->toFront(false);
+    }
+}
+
 void MainComponent::loadNewTest(NewTestSelectComponent &newTestSelectComponent) {
     Array <File> settingsFiles;
     
@@ -484,6 +521,21 @@ void MainComponent::loadNewTest(NewTestSelectComponent &newTestSelectComponent)
 
 
 void MainComponent::changeListenerCallback(ChangeBroadcaster *o) {
+    if (o == &testLauncher.getResultsWriter()) {
+        const String errors = testLauncher.getResultsWriter().takeErrors();
+        if (errors.isNotEmpty()) {
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Results could not be saved", errors, "OK", this);
+        }
+        return;
+    }
+
+    if (o == &testLauncher.getResultsReplicator()) {
+        ResultsReplicator &replicator = testLauncher.getResultsReplicator();
+        resultsStatusLabel.setText(replicator.getStatusText(), dontSendNotification);
+        resultsStatusLabel.setColour(Label::textColourId, replicator.isFailing() ? Colours::orange : Colours::lightgrey);
+        return;
+    }
+
     if (testComponent != NULL && o == testComponent) {
         if (testComponent->getTestFinished()) {
             ((DocumentWindow *) getParentComponent())->closeButtonPressed();
@@ -526,7 +578,7 @@ void MainComponent::changeListenerCallback(ChangeBroadcaster *o) {
 
 void MainComponent::timerCallback() {
     if (audioPlayer.isRunning()) {
-        float pos = floor(SLIDER_MAXVALUE * audioPlayer.getCurrentPosition());
+        double pos = floor(SLIDER_MAXVALUE * audioPlayer.getCurrentPosition());
         playbackSlider.setValue(pos, dontSendNotification);
 
         String tmpString = String::formatted("%3.1f", audioPlayer.getCurrentTime());
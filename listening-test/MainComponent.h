@@ -20,6 +20,7 @@
 #include "AVABTestComponent.h"
 
 #include "BasicSurveyComponent.h"
+#include "DiagnosticsComponent.h"
 
 #define CONCEAL_TRIAL_NAMES    // When defined, the test border will not indicate the name of each trial.
 
@@ -61,6 +62,9 @@ private:
 
     void resetPlayback();
 
+    /* shows or hides the playback diagnostics window, for test owners */
+    void toggleDiagnostics();
+
     void startPlayback() {
         if (audioPlayer.isPaused() || !audioPlayer.isRunning())
             togglePlayback();
@@ -141,12 +145,12 @@ private:
                 owner.playbackSlider.setValue(owner.playbackSliderMin, sendNotificationAsync);
                 owner.audioPlayer.setPosition(owner.playbackSliderMin / SLIDER_MAXVALUE);
             } else if (b == &owner.backButton) {
-                float interval = owner.playbackSliderMax - owner.playbackSliderMin;
-                float newMin = max(0, owner.playbackSliderMin - interval);
+                double interval = owner.playbackSliderMax - owner.playbackSliderMin;
+                double newMin = max(0, owner.playbackSliderMin - interval);
                 owner.playbackSlider.setMinAndMaxValues(newMin, newMin + interval);
             } else if (b == &owner.forwardButton) {
-                float interval = owner.playbackSliderMax - owner.playbackSliderMin;
-                float newMax = min(SLIDER_MAXVALUE, owner.playbackSliderMax + interval);
+                double interval = owner.playbackSliderMax - owner.playbackSliderMin;
+                double newMax = min(SLIDER_MAXVALUE, owner.playbackSliderMax + interval);
                 owner.playbackSlider.setMinAndMaxValues(newMax - interval, newMax);
             }
         }
@@ -192,8 +196,8 @@ private:
     SurveyComponent& surveyComponent = bsc;
 
     /* state */
-    float playbackSliderMin;
-    float playbackSliderMax;
+    double playbackSliderMin;
+    double playbackSliderMax;
     bool lockLoop;
 
     AudioPlayer audioPlayer;
@@ -225,7 +229,10 @@ private:
     TextButton showHotkeysButton;
 
     Label positionLabel;
+    Label resultsStatusLabel;
     Label hotkeyTextLabel;
+
+    std::unique_ptr <DiagnosticsWindow> diagnosticsWindow;
                                                     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent);
 };
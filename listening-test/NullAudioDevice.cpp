@@ -0,0 +1,256 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "NullAudioDevice.h"
+
+const nullDeviceCaptureEnum getNullDeviceCaptureEnum(String captureString) {
+    for (int i = 0; i < NUMBER_OF_NULL_DEVICE_CAPTURE_MODES; i++) {
+        if (nullDeviceCaptureModes[i].equalsIgnoreCase(captureString)) {
+            return static_cast<nullDeviceCaptureEnum>(i);
+        }
+    }
+    return NULL_DEVICE_CAPTURE_NONE;
+}
+
+//==============================================================================
+NullAudioDeviceOptions::NullAudioDeviceOptions() :
+        selectOnStart(false),
+        numOutputChannels(2),
+        sampleRate(48000.0),
+        blockSize(512),
+        speed(1.0),
+        jitterMs(0.0),
+        capture(NULL_DEVICE_CAPTURE_NONE) {
+}
+
+void NullAudioDeviceOptions::loadFromXml(const XmlElement &xml, const File &baseDirectory) {
+    selectOnStart = xml.getBoolAttribute("select", false);
+    numOutputChannels = jlimit(1, 256, xml.getIntAttribute("channels", 2));
+    sampleRate = jlimit(8000.0, 768000.0, xml.getDoubleAttribute("sampleRate", 48000.0));
+    blockSize = jlimit(1, 65536, xml.getIntAttribute("blockSize", 512));
+    speed = jmax(0.0, xml.getDoubleAttribute("speed", 1.0));
+    jitterMs = jmax(0.0, xml.getDoubleAttribute("jitterMs", 0.0));
+    capture = getNullDeviceCaptureEnum(xml.getStringAttribute("capture", nullDeviceCaptureModes[NULL_DEVICE_CAPTURE_NONE]));
+    captureFile = baseDirectory.getChildFile(xml.getStringAttribute("captureFile", "nullDevice.wav"));
+}
+
+//==============================================================================
+NullAudioIODevice::NullAudioIODevice(const NullAudioDeviceOptions &deviceOptions) :
+        AudioIODevice(NullAudioIODeviceType::deviceName, NullAudioIODeviceType::typeName),
+        Thread("Null audio device"),
+        options(deviceOptions),
+        deviceOpen(false),
+        currentSampleRate(deviceOptions.sampleRate),
+        currentBufferSize(deviceOptions.blockSize),
+        callback(nullptr),
+        xruns(0),
+        numBlocks(0),
+        capturedSamples(0) {
+}
+
+NullAudioIODevice::~NullAudioIODevice() {
+    close();
+}
+
+StringArray NullAudioIODevice::getOutputChannelNames() {
+    StringArray names;
+    for (int ch = 0; ch < options.numOutputChannels; ch++) {
+        names.add("Output " + String(ch + 1));
+    }
+    return names;
+}
+
+Array<double> NullAudioIODevice::getAvailableSampleRates() {
+    Array<double> rates(44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0);
+    rates.addIfNotAlreadyThere(options.sampleRate);
+    rates.sort();
+    return rates;
+}
+
+Array<int> NullAudioIODevice::getAvailableBufferSizes() {
+    Array<int> sizes;
+    for (int size = 16; size <= 4096; size *= 2) {
+        sizes.add(size);
+    }
+    sizes.addIfNotAlreadyThere(options.blockSize);
+    sizes.sort();
+    return sizes;
+}
+
+String NullAudioIODevice::open(const BigInteger & /*inputChannels*/, const BigInteger &outputChannels,
+                               double sampleRate, int bufferSizeSamples) {
+    close();
+
+    currentSampleRate = sampleRate > 0.0 ? sampleRate : options.sampleRate;
+    currentBufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : options.blockSize;
+    activeOutputChannels = outputChannels;
+    activeOutputChannels.setRange(options.numOutputChannels, jmax(0, outputChannels.getHighestBit() + 1), false);
+    outputs.setSize(activeOutputChannels.countNumberOfSetBits(), currentBufferSize);
+    xruns = 0;
+    numBlocks = 0;
+
+    {
+        const ScopedLock sl(captureLock);
+        capturedAudio.setSize(0, 0);
+        capturedSamples = 0;
+    }
+
+    lastError = String();
+    if (options.capture == NULL_DEVICE_CAPTURE_WAV) {
+        options.captureFile.deleteFile();
+        std::unique_ptr <FileOutputStream> stream(options.captureFile.createOutputStream());
+        if (stream != nullptr) {
+            WavAudioFormat wavFormat;
+            captureWriter.reset(wavFormat.createWriterFor(stream.get(), currentSampleRate,
+                                                          (unsigned int) outputs.getNumChannels(), 32,
+                                                          StringPairArray(), 0));
+        }
+        if (captureWriter == nullptr) {
+            lastError = "Cannot write the null device's output to " + options.captureFile.getFullPathName();
+            return lastError;
+        }
+        stream.release();
+    }
+
+    deviceOpen = true;
+    return lastError;
+}
+
+void NullAudioIODevice::close() {
+    stop();
+    captureWriter.reset();
+    deviceOpen = false;
+}
+
+void NullAudioIODevice::start(AudioIODeviceCallback *newCallback) {
+    if (!deviceOpen || newCallback == nullptr || newCallback == callback)
+        return;
+
+    stop();
+    newCallback->audioDeviceAboutToStart(this);
+    {
+        const ScopedLock sl(callbackLock);
+        callback = newCallback;
+    }
+    startThread();
+}
+
+void NullAudioIODevice::stop() {
+    stopThread(2000);
+
+    AudioIODeviceCallback *oldCallback;
+    {
+        const ScopedLock sl(callbackLock);
+        oldCallback = callback;
+        callback = nullptr;
+    }
+    if (oldCallback != nullptr) {
+        oldCallback->audioDeviceStopped();
+    }
+}
+
+bool NullAudioIODevice::isPlaying() {
+    const ScopedLock sl(callbackLock);
+    return callback != nullptr;
+}
+
+AudioBuffer<float> NullAudioIODevice::getCapturedAudio() {
+    const ScopedLock sl(captureLock);
+    AudioBuffer<float> result(capturedAudio.getNumChannels(), capturedSamples);
+    for (int ch = 0; ch < result.getNumChannels(); ch++) {
+        result.copyFrom(ch, 0, capturedAudio, ch, 0, capturedSamples);
+    }
+    return result;
+}
+
+void NullAudioIODevice::run() {
+    const AudioIODeviceCallbackContext context{};
+    const double blockMs = currentBufferSize * 1000.0 / currentSampleRate;
+    const double startMs = Time::getMillisecondCounterHiRes();
+    Random random;
+
+    for (int64 block = 0; !threadShouldExit(); block++) {
+        /* blocks are due on a fixed schedule, so a late one does not delay the ones after it */
+        if (options.speed > 0.0) {
+            const double dueMs = startMs + block * blockMs / options.speed;
+            waitUntil(dueMs + random.nextDouble() * options.jitterMs);
+            if (threadShouldExit())
+                break;
+        }
+
+        {
+            const ScopedLock sl(callbackLock);
+            if (callback != nullptr) {
+                callback->audioDeviceIOCallbackWithContext(nullptr, 0, outputs.getArrayOfWritePointers(),
+                                                           outputs.getNumChannels(), currentBufferSize, context);
+            } else {
+                outputs.clear();
+            }
+        }
+        ++numBlocks;
+
+        /* a sound card would have run out of samples to play */
+        if (options.speed > 0.0 && Time::getMillisecondCounterHiRes() > startMs + (block + 1) * blockMs / options.speed) {
+            ++xruns;
+        }
+
+        capture(currentBufferSize);
+    }
+}
+
+void NullAudioIODevice::waitUntil(double dueMs) {
+    for (;;) {
+        const double remainingMs = dueMs - Time::getMillisecondCounterHiRes();
+        if (remainingMs <= 0.0 || threadShouldExit())
+            return;
+
+        /* sleep while there is time, then spin for the last millisecond */
+        if (remainingMs > 2.0) {
+            wait((int) remainingMs - 1);
+        } else {
+            Thread::yield();
+        }
+    }
+}
+
+void NullAudioIODevice::capture(int numSamples) {
+    if (options.capture == NULL_DEVICE_CAPTURE_MEMORY) {
+        const ScopedLock sl(captureLock);
+        if (capturedSamples + numSamples > capturedAudio.getNumSamples()) {
+            const int newSize = jmax(capturedSamples + numSamples, capturedAudio.getNumSamples() * 2,
+                                     roundToInt(currentSampleRate));
+            capturedAudio.setSize(outputs.getNumChannels(), newSize, true, true, true);
+        }
+        for (int ch = 0; ch < outputs.getNumChannels(); ch++) {
+            capturedAudio.copyFrom(ch, capturedSamples, outputs, ch, 0, numSamples);
+        }
+        capturedSamples += numSamples;
+    } else if (captureWriter != nullptr) {
+        captureWriter->writeFromFloatArrays(outputs.getArrayOfReadPointers(), outputs.getNumChannels(), numSamples);
+    }
+}
+
+//==============================================================================
+const String NullAudioIODeviceType::typeName("Null");
+const String NullAudioIODeviceType::deviceName("Null output");
+
+NullAudioIODeviceType::NullAudioIODeviceType() :
+        AudioIODeviceType(typeName) {
+}
+
+StringArray NullAudioIODeviceType::getDeviceNames(bool wantInputNames) const {
+    return wantInputNames ? StringArray() : StringArray(deviceName);
+}
+
+int NullAudioIODeviceType::getIndexOfDevice(AudioIODevice *device, bool asInput) const {
+    return !asInput && dynamic_cast<NullAudioIODevice *>(device) != nullptr ? 0 : -1;
+}
+
+AudioIODevice *NullAudioIODeviceType::createDevice(const String &outputDeviceName, const String & /*inputDeviceName*/) {
+    /* there are no inputs, so an input name left over from another device type is ignored */
+    if (outputDeviceName != deviceName)
+        return nullptr;
+
+    return new NullAudioIODevice(options);
+}
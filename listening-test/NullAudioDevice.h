@@ -0,0 +1,175 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef NULL_AUDIO_DEVICE_H
+#define NULL_AUDIO_DEVICE_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+typedef enum {
+    NULL_DEVICE_CAPTURE_NONE = 0,
+    NULL_DEVICE_CAPTURE_MEMORY,
+    NULL_DEVICE_CAPTURE_WAV,
+    NUMBER_OF_NULL_DEVICE_CAPTURE_MODES
+} nullDeviceCaptureEnum;
+
+// NO SPACES ALLOWED IN THESE NAMES!
+const String nullDeviceCaptureModes[] = {
+        "none",
+        "memory",
+        "wav"
+};
+
+const nullDeviceCaptureEnum getNullDeviceCaptureEnum(String captureString);
+
+/**
+    How the null audio device behaves, read from a <nullDevice> element such as
+
+        <nullDevice select="1" channels="8" sampleRate="48000" blockSize="256"
+                    speed="0" jitterMs="2" capture="wav" captureFile="output.wav"/>
+
+    speed is a multiple of real time; 0 runs the callbacks as fast as possible.
+*/
+struct NullAudioDeviceOptions {
+    NullAudioDeviceOptions();
+
+    /* relative capture files are taken from baseDirectory */
+    void loadFromXml(const XmlElement &xml, const File &baseDirectory);
+
+    bool selectOnStart;     // use the null device whatever device was saved
+    int numOutputChannels;
+    double sampleRate;
+    int blockSize;
+    double speed;
+    double jitterMs;        // callbacks start up to this much later than due
+    nullDeviceCaptureEnum capture;
+    File captureFile;
+};
+
+
+/**
+    Audio device without hardware: a thread of its own calls the callback at the pace set
+    in the options, and what the callback writes can be kept in memory or written to a WAV
+    file.  Lets playback run on machines without a sound card, and faster than real time.
+*/
+class NullAudioIODevice : public AudioIODevice,
+                          private Thread {
+public:
+    explicit NullAudioIODevice(const NullAudioDeviceOptions &deviceOptions);
+
+    ~NullAudioIODevice();
+
+    StringArray getOutputChannelNames() override;
+
+    StringArray getInputChannelNames() override { return StringArray(); }
+
+    Array<double> getAvailableSampleRates() override;
+
+    Array<int> getAvailableBufferSizes() override;
+
+    int getDefaultBufferSize() override { return options.blockSize; }
+
+    String open(const BigInteger &inputChannels, const BigInteger &outputChannels, double sampleRate,
+                int bufferSizeSamples) override;
+
+    void close() override;
+
+    bool isOpen() override { return deviceOpen; }
+
+    void start(AudioIODeviceCallback *newCallback) override;
+
+    void stop() override;
+
+    bool isPlaying() override;
+
+    String getLastError() override { return lastError; }
+
+    int getCurrentBufferSizeSamples() override { return currentBufferSize; }
+
+    double getCurrentSampleRate() override { return currentSampleRate; }
+
+    int getCurrentBitDepth() override { return 32; }
+
+    BigInteger getActiveOutputChannels() const override { return activeOutputChannels; }
+
+    BigInteger getActiveInputChannels() const override { return BigInteger(); }
+
+    int getOutputLatencyInSamples() override { return 0; }
+
+    int getInputLatencyInSamples() override { return 0; }
+
+    /* Blocks whose callback finished after the next block was due; only counted in real time */
+    int getXRunCount() const noexcept override { return xruns; }
+
+    /* Number of callbacks made since the device was opened */
+    int64 getNumBlocks() const { return numBlocks; }
+
+    /* Copy of everything played since the device was opened, when capturing to memory */
+    AudioBuffer<float> getCapturedAudio();
+
+private:
+    void run() override;
+
+    /* waits until the given time, in milliseconds on the hi-res counter */
+    void waitUntil(double dueMs);
+
+    void capture(int numSamples);
+
+    const NullAudioDeviceOptions options;
+    bool deviceOpen;
+    String lastError;
+    double currentSampleRate;
+    int currentBufferSize;
+    BigInteger activeOutputChannels;
+    AudioBuffer<float> outputs;
+
+    CriticalSection callbackLock;
+    AudioIODeviceCallback *callback;
+    std::atomic<int> xruns;
+    std::atomic <int64> numBlocks;
+
+    CriticalSection captureLock;
+    AudioBuffer<float> capturedAudio;
+    int capturedSamples;
+    std::unique_ptr <AudioFormatWriter> captureWriter;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NullAudioIODevice);
+};
+
+
+/**
+    Device type offering the one NullAudioIODevice.  Devices are created with the options
+    set last.
+*/
+class NullAudioIODeviceType : public AudioIODeviceType {
+public:
+    NullAudioIODeviceType();
+
+    void setOptions(const NullAudioDeviceOptions &newOptions) { options = newOptions; }
+
+    const NullAudioDeviceOptions &getOptions() const { return options; }
+
+    void scanForDevices() override {}
+
+    StringArray getDeviceNames(bool wantInputNames) const override;
+
+    int getDefaultDeviceIndex(bool forInput) const override { return forInput ? -1 : 0; }
+
+    int getIndexOfDevice(AudioIODevice *device, bool asInput) const override;
+
+    bool hasSeparateInputsAndOutputs() const override { return true; }
+
+    AudioIODevice *createDevice(const String &outputDeviceName, const String &inputDeviceName) override;
+
+    static const String typeName;
+    static const String deviceName;
+
+private:
+    NullAudioDeviceOptions options;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NullAudioIODeviceType);
+};
+
+#endif /* NULL_AUDIO_DEVICE_H */
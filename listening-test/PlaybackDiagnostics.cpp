@@ -0,0 +1,162 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "PlaybackDiagnostics.h"
+
+TimingEventQueue::TimingEventQueue() :
+        fifo(queueSize) {
+}
+
+bool TimingEventQueue::push(const TimingEvent &event) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    events[size1 > 0 ? start1 : start2] = event;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool TimingEventQueue::pop(TimingEvent &event) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    event = events[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+Histogram::Histogram(const Array<double> &bucketEdges) :
+        edges(bucketEdges) {
+    counts.insertMultiple(0, 0, edges.size() + 1);
+    clear();
+}
+
+void Histogram::add(double value) {
+    int bucket = 0;
+    while (bucket < edges.size() && value >= edges[bucket]) {
+        ++bucket;
+    }
+    counts.getReference(bucket)++;
+    ++total;
+    sum += value;
+    maximum = jmax(maximum, value);
+}
+
+void Histogram::clear() {
+    counts.fill(0);
+    total = 0;
+    sum = 0.0;
+    maximum = 0.0;
+}
+
+String Histogram::getBucketName(int bucket) const {
+    if (bucket == 0)
+        return "<" + String(edges[0]);
+    if (bucket == edges.size())
+        return ">" + String(edges.getLast());
+    return String(edges[bucket - 1]) + "-" + String(edges[bucket]);
+}
+
+String Histogram::toString(const String &unit) const {
+    String text = String::formatted("n=%lld mean %.2f %s max %.2f %s", (long long) total, getMean(),
+                                    unit.toRawUTF8(), getMax(), unit.toRawUTF8());
+    for (int i = 0; i < counts.size(); i++) {
+        if (counts[i] > 0) {
+            text << "; " << getBucketName(i) << " " << unit << ": " << counts[i];
+        }
+    }
+    return text;
+}
+
+//==============================================================================
+PlaybackDiagnostics::PlaybackDiagnostics() :
+        loadPercent(Array<double>(10.0, 20.0, 30.0, 40.0, 50.0, 60.0, 70.0, 80.0, 90.0, 100.0)),
+        switchLatencyMs(Array<double>(5.0, 10.0, 20.0, 30.0, 50.0, 100.0)),
+        commandLatencyMs(Array<double>(1.0, 2.0, 5.0, 10.0, 20.0, 50.0)),
+        deviceReportsXRuns(false),
+        outputLatencyMs(0.0) {
+    reset();
+}
+
+void PlaybackDiagnostics::reset() {
+    loadPercent.clear();
+    switchLatencyMs.clear();
+    commandLatencyMs.clear();
+    callbackSeconds = 0.0;
+    audioSeconds = 0.0;
+    recentLoad = 0.0;
+    overruns = 0;
+    lateCallbacks = 0;
+    deviceXRuns = 0;
+    eventsLost = false;
+}
+
+void PlaybackDiagnostics::addEvent(const TimingEvent &event, double sampleRate) {
+    if (sampleRate <= 0.0)
+        return;
+
+    switch (event.type) {
+        case TimingEvent::start:
+            break;
+
+        case TimingEvent::callback: {
+            const double blockMs = event.numSamples * 1000.0 / sampleRate;
+            const double callbackMs = ticksToMs(event.endTicks - event.startTicks);
+            if (blockMs <= 0.0)
+                break;
+
+            const double load = callbackMs / blockMs;
+            loadPercent.add(load * 100.0);
+            callbackSeconds += callbackMs / 1000.0;
+            audioSeconds += blockMs / 1000.0;
+            recentLoad = jmax(recentLoad, load);
+
+            /* classified by the engine, which counts the same glitches for the results */
+            if (event.overran) {
+                ++overruns;
+            }
+            if (event.late) {
+                ++lateCallbacks;
+            }
+            break;
+        }
+
+        case TimingEvent::commandArrived:
+            commandLatencyMs.add(ticksToMs(event.startTicks - event.postedTicks));
+            break;
+
+        case TimingEvent::switchStarted:
+            switchLatencyMs.add(ticksToMs(event.startTicks - event.postedTicks)
+                                + event.numSamples * 1000.0 / sampleRate + outputLatencyMs);
+            break;
+    }
+}
+
+double PlaybackDiagnostics::takeRecentLoad() {
+    const double load = recentLoad;
+    recentLoad = 0.0;
+    return load;
+}
+
+String PlaybackDiagnostics::getSummary() const {
+    String summary = String::formatted("Playback diagnostics: %lld callbacks, mean load %.1f%%, peak load %.1f%%, "
+                                       "%lld overrun(s), %lld late callback(s), ",
+                                       (long long) getNumCallbacks(), getMeanLoad() * 100.0, getPeakLoad() * 100.0,
+                                       (long long) overruns, (long long) lateCallbacks);
+    summary << (deviceReportsXRuns ? String(deviceXRuns) + " device xrun(s)" : String("device xruns not reported"));
+    if (eventsLost) {
+        summary << " (some timings were lost)";
+    }
+
+    summary << newLine << "\tcallback load: " << loadPercent.toString("%")
+            << newLine << "\tclick to audio thread: " << commandLatencyMs.toString("ms")
+            << newLine << "\tclick to new stimulus heard, including "
+            << String(outputLatencyMs, 1) << " ms output latency: " << switchLatencyMs.toString("ms");
+    return summary;
+}
@@ -0,0 +1,184 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef PLAYBACK_DIAGNOSTICS_H
+#define PLAYBACK_DIAGNOSTICS_H
+
+#include <JuceHeader.h>
+
+/**
+    A timestamp taken by the audio thread, in Time::getHighResolutionTicks().
+*/
+struct TimingEvent {
+    enum Type {
+        start,          // the device started; the next callback does not follow on from the last one
+        callback,       // a callback of numSamples samples ran from startTicks to endTicks; overran and
+                        // late tell whether it most likely left a gap
+        commandArrived, // the callback starting at startTicks picked up a command posted at postedTicks
+        switchStarted   // the stimulus selected at postedTicks is heard from numSamples samples into
+                        // the callback starting at startTicks
+    };
+
+    Type type;
+    int64 startTicks;
+    int64 endTicks;
+    int64 postedTicks;
+    int numSamples;
+    bool overran;       // the callback took longer than its block lasts
+    bool late;          // it started more than two blocks after the one before
+};
+
+/**
+    Single-producer, single-consumer lock-free ring of TimingEvents, filled by the audio
+    thread and emptied by the message thread.
+*/
+class TimingEventQueue {
+public:
+    TimingEventQueue();
+
+    /* Producer side; returns false if the ring is full */
+    bool push(const TimingEvent &event);
+
+    /* Consumer side; returns false if the ring is empty */
+    bool pop(TimingEvent &event);
+
+private:
+    enum {
+        queueSize = 4096
+    };
+
+    AbstractFifo fifo;
+    TimingEvent events[queueSize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimingEventQueue);
+};
+
+/**
+    Dropouts that may have been heard while playing: device xruns, callbacks that overran their
+    block or came late, and restarts of the device that the player did not ask for.
+*/
+struct PlaybackGlitches {
+    int xruns;
+    int lateCallbacks;
+    int restarts;
+
+    bool any() const { return xruns > 0 || lateCallbacks > 0 || restarts > 0; }
+
+    PlaybackGlitches &operator+=(const PlaybackGlitches &other) {
+        xruns += other.xruns;
+        lateCallbacks += other.lateCallbacks;
+        restarts += other.restarts;
+        return *this;
+    }
+};
+
+/**
+    Counts of values falling between fixed bucket edges, with the mean and maximum.
+*/
+class Histogram {
+public:
+    /* edges in ascending order; values above the last one go to an extra bucket */
+    Histogram(const Array<double> &edges);
+
+    void add(double value);
+
+    void clear();
+
+    int getNumBuckets() const { return counts.size(); }
+
+    int64 getCount(int bucket) const { return counts[bucket]; }
+
+    /* "2-5" style label of a bucket, without the unit */
+    String getBucketName(int bucket) const;
+
+    int64 getTotal() const { return total; }
+
+    double getMean() const { return total > 0 ? sum / (double) total : 0.0; }
+
+    double getMax() const { return maximum; }
+
+    /* one line: the total, mean and max, then every bucket that is not empty */
+    String toString(const String &unit) const;
+
+private:
+    Array<double> edges;
+    Array <int64> counts;
+    int64 total;
+    double sum;
+    double maximum;
+};
+
+/**
+    Aggregates the audio thread's TimingEvents on the message thread: how much of each block's
+    duration the callback took, callbacks that overran their block or arrived late, the xruns
+    the device reports, and how long a stimulus switch takes from the click to the first sample
+    of the new stimulus leaving the device.
+*/
+class PlaybackDiagnostics {
+public:
+    PlaybackDiagnostics();
+
+    void reset();
+
+    void addEvent(const TimingEvent &event, double sampleRate);
+
+    /* count newXRuns more xruns reported by the device */
+    void addDeviceXRuns(int newXRuns) { deviceXRuns += newXRuns; }
+
+    /* false if the device does not count its xruns */
+    void setDeviceReportsXRuns(bool reports) { deviceReportsXRuns = reports; }
+
+    /* the time from rendering a sample to hearing it, added to the switch latencies */
+    void setOutputLatencyMs(double latencyMs) { outputLatencyMs = latencyMs; }
+
+    void setEventsLost() { eventsLost = true; }
+
+    /* highest callback load since the last call, as a fraction of the block duration */
+    double takeRecentLoad();
+
+    int64 getNumCallbacks() const { return loadPercent.getTotal(); }
+
+    double getMeanLoad() const { return audioSeconds > 0.0 ? callbackSeconds / audioSeconds : 0.0; }
+
+    double getPeakLoad() const { return loadPercent.getMax() / 100.0; }
+
+    int64 getOverruns() const { return overruns; }
+
+    int64 getLateCallbacks() const { return lateCallbacks; }
+
+    int64 getDeviceXRuns() const { return deviceXRuns; }
+
+    bool getDeviceReportsXRuns() const { return deviceReportsXRuns; }
+
+    double getOutputLatencyMs() const { return outputLatencyMs; }
+
+    const Histogram &getLoadHistogram() const { return loadPercent; }
+
+    const Histogram &getSwitchLatencyHistogram() const { return switchLatencyMs; }
+
+    const Histogram &getCommandLatencyHistogram() const { return commandLatencyMs; }
+
+    /* the aggregates, a few lines long, for the log */
+    String getSummary() const;
+
+private:
+    double ticksToMs(int64 ticks) const { return Time::highResolutionTicksToSeconds(ticks) * 1000.0; }
+
+    Histogram loadPercent;
+    Histogram switchLatencyMs;
+    Histogram commandLatencyMs;
+    double callbackSeconds;
+    double audioSeconds;
+    double recentLoad;
+    int64 overruns;
+    int64 lateCallbacks;
+    int64 deviceXRuns;
+    bool deviceReportsXRuns;
+    double outputLatencyMs;
+    bool eventsLost;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaybackDiagnostics);
+};
+
+#endif /* PLAYBACK_DIAGNOSTICS_H */
@@ -0,0 +1,425 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "PlaybackEngine.h"
+#include "AudioThreadGuard.h"
+
+PlaybackEngine::PlaybackEngine() :
+        currentSample(0),
+        startSample(0),
+        endSample(0),
+        playInLoop(true),
+        currentStimulus(-1),
+        nextStimulus(-1),
+        playerPaused(false),
+        channelCount(0),
+        stimulusSet(new StimulusSet),
+        sampleRate(0.0),
+        crossfadeMs(10.0),
+        crossfadeShape(CROSSFADE_SHAPE_LINEAR),
+        loopCrossfadeSamples(0),
+        pendingLoopCrossfadeSamples(0),
+        appliedCommands(0),
+        recordingEvents(false),
+        eventsLost(false),
+        renderedSamples(0),
+        lastBlockSize(0),
+        recordingTimings(false),
+        timingsLost(false),
+        callbackStartTicks(0),
+        lastCallbackStartTicks(0),
+        glitchedCallbacks(0),
+        switchPostedTicks(0) {
+}
+
+void PlaybackEngine::prepare(double newSampleRate, int maximumBlockSize) {
+    sampleRate = newSampleRate;
+
+    const int blockSize = jmax(1, maximumBlockSize);
+    mixBuffer.setSize(MAXNUMBEROFDEVICECHANNELS, blockSize);
+    voiceBuffer.setSize(MAXNUMBEROFDEVICECHANNELS, blockSize);
+    crossfader.prepare(sampleRate, crossfadeMs, crossfadeShape);
+    crossfader.reset(-1);
+
+    loopHeadBuffer.setSize(MAXNUMBEROFDEVICECHANNELS, blockSize);
+    loopCrossfadeSamples = pendingLoopCrossfadeSamples;
+    loopFadeInGains.malloc((size_t) jmax(1, loopCrossfadeSamples));
+    loopFadeOutGains.malloc((size_t) jmax(1, loopCrossfadeSamples));
+    Crossfader::fillGains(loopFadeInGains, loopFadeOutGains, loopCrossfadeSamples, crossfadeShape);
+
+    applyPendingCommands();
+    currentStimulus = -1;
+    nextStimulus = -1;
+    playerPaused = true;
+    switchPostedTicks = 0;
+    listening.endAudition();
+    publishState();
+    lastCallbackStartTicks = 0;
+    recordTiming(TimingEvent::start, 0, 0);
+
+    lastBlockSize = blockSize;
+    PlaybackEvent event = {PlaybackEvent::prepare, getRenderedSamples()};
+    event.sampleRate = sampleRate;
+    event.blockSize = blockSize;
+    recordEvent(event);
+}
+
+void PlaybackEngine::setStimulusSet(std::unique_ptr <StimulusSet> newSet) {
+    channelCount = newSet->channelCount;
+    listening.prepare(newSet->stimuli.size());
+    stimulusSet = std::move(newSet);
+}
+
+void PlaybackEngine::setCrossfade(double fadeMs, crossfadeShapeEnum shape, int loopFadeSamples) {
+    crossfadeMs = fadeMs;
+    crossfadeShape = shape;
+
+    /* the loop fade tables are sized in prepare(), so a new length must wait for it too */
+    pendingLoopCrossfadeSamples = loopFadeSamples;
+}
+
+void PlaybackEngine::applyCommandNow(const PlayerCommand &command) {
+    applyPendingCommands();
+    applyCommand(command);
+    publishState();
+
+    /* nothing is playing, so there is no switch latency to measure */
+    switchPostedTicks = 0;
+}
+
+void PlaybackEngine::recordState() {
+    const PlayerCommand state[] = {
+            {PlayerCommand::setFragmentStart, startSample},
+            {PlayerCommand::setFragmentEnd,   endSample},
+            {PlayerCommand::setPlayLoop,      playInLoop ? 1 : 0},
+            {PlayerCommand::setSample,        currentSample},
+            {PlayerCommand::switchStimulus,   nextStimulus},
+            {playerPaused ? PlayerCommand::pause : PlayerCommand::resume, 0}
+    };
+    for (const PlayerCommand &command : state) {
+        PlaybackEvent event = {PlaybackEvent::command, getRenderedSamples(), command};
+        recordEvent(event);
+    }
+}
+
+void PlaybackEngine::recordStop() {
+    const PlaybackEvent event = {PlaybackEvent::stop, getRenderedSamples()};
+    recordEvent(event);
+}
+
+void PlaybackEngine::recordEvent(const PlaybackEvent &event) {
+    if (recordingEvents && !eventQueue.push(event)) {
+        eventsLost = true;
+    }
+}
+
+void PlaybackEngine::recordTiming(TimingEvent::Type type, int64 postedTicks, int numSamples) {
+    if (!recordingTimings)
+        return;
+
+    const TimingEvent event = {type, callbackStartTicks, Time::getHighResolutionTicks(), postedTicks, numSamples,
+                               false, false};
+    if (!timingQueue.push(event)) {
+        timingsLost = true;
+    }
+}
+
+void PlaybackEngine::recordCallback(int numSamples) {
+    if (recordingTimings) {
+        /* a callback that overran its block, or came more than a block late, most likely left a gap */
+        const int64 endTicks = Time::getHighResolutionTicks();
+        const double blockSeconds = numSamples / jmax(1.0, sampleRate);
+        TimingEvent event = {TimingEvent::callback, callbackStartTicks, endTicks, 0, numSamples, false, false};
+        event.overran = Time::highResolutionTicksToSeconds(endTicks - callbackStartTicks) > blockSeconds;
+        event.late = lastCallbackStartTicks != 0
+                     && Time::highResolutionTicksToSeconds(callbackStartTicks - lastCallbackStartTicks)
+                        > 2.0 * blockSeconds;
+        lastCallbackStartTicks = callbackStartTicks;
+
+        /* only glitches while the stimuli play count, silence cannot be spoiled */
+        if ((event.overran || event.late) && !playerPaused) {
+            ++glitchedCallbacks;
+        }
+        if (!timingQueue.push(event)) {
+            timingsLost = true;
+        }
+    }
+    callbackStartTicks = 0;
+}
+
+bool PlaybackEngine::replay(const PlaybackLog &log, int numOutputs,
+                            const std::function<bool(const AudioBuffer<float> &, int)> &write) {
+    setRouting(log.routing);
+    setCrossfade(log.crossfadeMs, log.crossfadeShape, log.loopCrossfadeSamples);
+
+    AudioBuffer<float> outputs(numOutputs, 1);
+    int blockSize = 0;      // 0 while the device is stopped
+    int64 rendered = log.events.isEmpty() ? log.endSample : log.events.getFirst().sample;
+
+    for (int i = 0; i <= log.events.size(); i++) {
+        const int64 nextSample = i < log.events.size() ? log.events.getReference(i).sample : log.endSample;
+        if (nextSample < rendered)
+            return false;
+
+        while (blockSize > 0 && rendered < nextSample) {
+            const int numSamples = (int) jmin((int64) blockSize, nextSample - rendered);
+            process(outputs.getArrayOfWritePointers(), numOutputs, numSamples);
+            if (!write(outputs, numSamples))
+                return false;
+            rendered += numSamples;
+        }
+        rendered = nextSample;
+
+        if (i == log.events.size())
+            break;
+
+        const PlaybackEvent &event = log.events.getReference(i);
+        switch (event.type) {
+            case PlaybackEvent::prepare:
+                prepare(event.sampleRate, event.blockSize);
+                blockSize = jmax(1, event.blockSize);
+                break;
+            case PlaybackEvent::blockSize:
+                blockSize = jmax(1, event.blockSize);
+                break;
+            case PlaybackEvent::stop:
+                blockSize = 0;
+                break;
+            case PlaybackEvent::command:
+                applyCommandNow(event.playerCommand);
+                break;
+        }
+        if (blockSize > outputs.getNumSamples()) {
+            outputs.setSize(numOutputs, blockSize);
+        }
+    }
+
+    return true;
+}
+
+void PlaybackEngine::applyPendingCommands() {
+    PlayerCommand command;
+    while (commandQueue.pop(command)) {
+        applyCommand(command);
+    }
+}
+
+void PlaybackEngine::applyCommand(const PlayerCommand &command) {
+    switch (command.type) {
+        case PlayerCommand::switchStimulus:
+            nextStimulus = (int) command.value;
+            switchPostedTicks = command.postedTicks;
+            break;
+        case PlayerCommand::setSample:
+            currentSample = command.value;
+            break;
+        case PlayerCommand::setFragmentStart:
+            startSample = command.value;
+            break;
+        case PlayerCommand::setFragmentEnd:
+            endSample = command.value;
+            break;
+        case PlayerCommand::setPlayLoop:
+            playInLoop = command.value != 0;
+            break;
+        case PlayerCommand::pause:
+            /* do not carry half-finished fades over to the next resume */
+            playerPaused = true;
+            crossfader.reset(currentStimulus);
+            switchPostedTicks = 0;
+            listening.endAudition();
+            break;
+        case PlayerCommand::resume:
+            playerPaused = false;
+            break;
+    }
+    ++appliedCommands;
+
+    if (callbackStartTicks != 0 && command.postedTicks != 0) {
+        recordTiming(TimingEvent::commandArrived, command.postedTicks, 0);
+    }
+
+    const PlaybackEvent event = {PlaybackEvent::command, getRenderedSamples(), command};
+    recordEvent(event);
+}
+
+void PlaybackEngine::publishState() {
+    const PlaybackState state = {currentSample, currentStimulus, nextStimulus, playerPaused, appliedCommands};
+    stateSnapshot.publish(state);
+}
+
+//==============================================================================
+void PlaybackEngine::process(float *const *outputs, int numOutputs, int numSamples) {
+    const ScopedAudioThreadSection audioThreadSection;
+    callbackStartTicks = recordingTimings ? Time::getHighResolutionTicks() : 0;
+
+    /* the replay needs the same block sizes, because they decide where commands take effect */
+    if (numSamples != lastBlockSize) {
+        lastBlockSize = numSamples;
+        PlaybackEvent event = {PlaybackEvent::blockSize, getRenderedSamples()};
+        event.blockSize = numSamples;
+        recordEvent(event);
+    }
+
+    applyPendingCommands();
+
+    for (int ch = 0; ch < numOutputs; ch++) {
+        if (outputs[ch] != nullptr) {
+            FloatVectorOperations::clear(outputs[ch], numSamples);
+        }
+    }
+
+    if (channelCount > mixBuffer.getNumChannels() || mixBuffer.getNumSamples() == 0) {
+        renderedSamples.fetch_add(numSamples, std::memory_order_release);
+        publishState();
+        recordCallback(numSamples);
+        return;
+    }
+
+    /* the device may deliver more than the block size it announced, so render in pieces */
+    for (int done = 0; done < numSamples;) {
+        const int num = jmin(numSamples - done, mixBuffer.getNumSamples());
+        renderBlock(done, num);
+        routing.process(mixBuffer, channelCount, outputs, numOutputs, done, num);
+        done += num;
+    }
+
+    /* let streamed stimuli follow the playhead, including the ones not currently heard */
+    for (int i = 0; i < stimulusSet->stimuli.size(); i++) {
+        stimulusSet->stimuli.getUnchecked(i)->setPlayhead(currentSample, startSample);
+    }
+
+    renderedSamples.fetch_add(numSamples, std::memory_order_release);
+    publishState();
+    recordCallback(numSamples);
+}
+
+void PlaybackEngine::renderBlock(int blockOffset, int numOutSamples) {
+    for (int ch = 0; ch < channelCount; ch++) {
+        mixBuffer.clear(ch, 0, numOutSamples);
+    }
+
+    if (playerPaused)
+        return;
+
+    /* start fading to the newly selected stimulus; the first one selected starts at once */
+    if (currentStimulus != nextStimulus) {
+        if (currentStimulus == -1) {
+            crossfader.reset(nextStimulus);
+        } else {
+            crossfader.switchTo(nextStimulus);
+        }
+        currentStimulus = nextStimulus;
+
+        if (switchPostedTicks != 0) {
+            recordTiming(TimingEvent::switchStarted, switchPostedTicks, blockOffset);
+        }
+    }
+    switchPostedTicks = 0;
+    listening.add(currentStimulus, startSample, endSample, playInLoop, numOutSamples);
+
+    for (int i = 0; i < crossfader.getNumVoices(); i++) {
+        const int stimulus = crossfader.getVoice(i).stimulus;
+        if (i == 0 && crossfader.isUnity(i)) {
+            /* the common case: one stimulus playing, straight into the mix */
+            readStimulus(stimulus, mixBuffer, numOutSamples);
+        } else {
+            readStimulus(stimulus, voiceBuffer, numOutSamples);
+            crossfader.mixVoice(i, mixBuffer, voiceBuffer, channelCount, numOutSamples);
+        }
+    }
+    crossfader.advance(numOutSamples);
+
+    /* advance audio buffer */
+    currentSample += numOutSamples;
+    if (currentSample >= endSample) {
+        if (playInLoop && endSample > startSample) {
+            /* the loop may be shorter than the block */
+            currentSample = startSample + (currentSample - endSample) % (endSample - startSample);
+        } else {
+            playerPaused = true;
+            currentSample = startSample;
+            crossfader.reset(currentStimulus);
+            listening.endAudition();
+        }
+    }
+}
+
+void PlaybackEngine::readStimulus(int stimulus, AudioBuffer<float> &dest, int numSamples) {
+    if (stimulus < 0 || stimulus >= stimulusSet->stimuli.size()) {
+        for (int ch = 0; ch < channelCount; ch++) {
+            dest.clear(ch, 0, numSamples);
+        }
+        return;
+    }
+
+    StimulusSource &source = *stimulusSet->stimuli.getUnchecked(stimulus);
+    const float gain = stimulus < stimulusSet->gains.size() ? stimulusSet->gains.getUnchecked(stimulus) : 1.0f;
+    const bool looping = playInLoop && endSample > startSample;
+    const int fadeLength = looping ? (int) jmin((int64) loopCrossfadeSamples, endSample - startSample) : 0;
+    const int64 fadeStart = endSample - fadeLength;
+
+    int64 position = currentSample;
+    for (int done = 0; done < numSamples;) {
+        if (position >= endSample) {
+            if (!looping) {
+                for (int ch = 0; ch < channelCount; ch++) {
+                    dest.clear(ch, done, numSamples - done);
+                }
+                break;
+            }
+            position = startSample;
+        }
+
+        /* Copy as much as possible from input file */
+        const int num = (int) jmin((int64) (numSamples - done), endSample - position);
+        source.read(dest, done, position, num);
+
+        /* the end of the loop fades into what precedes its start, so the jump back is seamless */
+        if (position + num > fadeStart) {
+            const int64 first = jmax(position, fadeStart);
+            blendLoopHead(source, dest, done + (int) (first - position), (int) (first - fadeStart), fadeLength,
+                          (int) (position + num - first));
+        }
+
+        done += num;
+        position += num;
+    }
+
+    /* level matching */
+    if (gain != 1.0f) {
+        for (int ch = 0; ch < channelCount; ch++) {
+            FloatVectorOperations::multiply(dest.getWritePointer(ch), gain, numSamples);
+        }
+    }
+}
+
+void PlaybackEngine::blendLoopHead(StimulusSource &source, AudioBuffer<float> &dest, int destStartSample,
+                                   int fadePosition, int fadeLength, int numSamples) {
+    /* samples before the start of the file are silence */
+    const int64 headSample = startSample - fadeLength + fadePosition;
+    const int silent = (int) jlimit((int64) 0, (int64) numSamples, -headSample);
+    for (int ch = 0; ch < channelCount; ch++) {
+        loopHeadBuffer.clear(ch, 0, silent);
+    }
+    if (numSamples > silent) {
+        source.read(loopHeadBuffer, silent, headSample + silent, numSamples - silent);
+    }
+
+    for (int ch = 0; ch < channelCount; ch++) {
+        float *d = dest.getWritePointer(ch, destStartSample);
+        const float *head = loopHeadBuffer.getReadPointer(ch);
+
+        if (fadeLength == loopCrossfadeSamples) {
+            FloatVectorOperations::multiply(d, loopFadeOutGains + fadePosition, numSamples);
+            FloatVectorOperations::addWithMultiply(d, head, loopFadeInGains + fadePosition, numSamples);
+        } else {
+            /* a loop shorter than the fade stretches the gain tables over the whole loop */
+            for (int i = 0; i < numSamples; i++) {
+                const int g = (int) ((int64) (fadePosition + i) * loopCrossfadeSamples / fadeLength);
+                d[i] = d[i] * loopFadeOutGains[g] + head[i] * loopFadeInGains[g];
+            }
+        }
+    }
+}
@@ -0,0 +1,200 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef PLAYBACK_ENGINE_H
+#define PLAYBACK_ENGINE_H
+
+#include <JuceHeader.h>
+#include "StimulusSet.h"
+#include "PlayerCommands.h"
+#include "PlaybackLog.h"
+#include "PlaybackDiagnostics.h"
+#include "ListeningTime.h"
+#include "Crossfader.h"
+#include "RoutingMatrix.h"
+#include <functional>
+
+#define    MAXNUMBEROFDEVICECHANNELS    64
+
+/**
+    Everything the audio callback does, without the device: applies the queued PlayerCommands,
+    mixes the stimuli of the trial with their crossfades and loop fades, routes the mix onto the
+    outputs and publishes the PlaybackState.  The AudioPlayer drives it from the device callback;
+    anything else that needs the exact same audio, such as the benchmark or the offline renderer,
+    can call process() itself.
+
+    While recording, every command applied, every prepare() and every change of block size is
+    queued as a PlaybackEvent stamped with the samples rendered so far.  Replaying the events
+    into another engine with the same stimuli renders the same samples.
+
+    While timing, every callback, every command picked up and every switch to a new stimulus
+    is queued as a TimingEvent for the PlaybackDiagnostics.
+
+    The samples rendered of every stimulus are always counted, and the playback is split into
+    Auditions, for the listening time of each condition.
+*/
+class PlaybackEngine {
+public:
+    PlaybackEngine();
+
+    /* Allocates what process() needs for blocks of up to maximumBlockSize samples and stops
+       playback.  Call while process() is not running. */
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    /* Clears the outputs and renders numSamples samples into them.  Does not allocate or block. */
+    void process(float *const *outputs, int numOutputs, int numSamples);
+
+    /* Queues a command for the next process() call; false if the queue is full */
+    bool pushCommand(const PlayerCommand &command) { return commandQueue.push(command); }
+
+    /* Applies the queued commands and then command straight away, and publishes the new state.
+       Only while process() is not running. */
+    void applyCommandNow(const PlayerCommand &command);
+
+    /* The state as of the end of the last process() call or applyCommandNow() */
+    PlaybackState getState() const { return stateSnapshot.read(); }
+
+    /* The setters below only take effect safely while process() is not running; the fade
+       settings are picked up by the next prepare(). */
+    void setStimulusSet(std::unique_ptr <StimulusSet> newSet);
+
+    void releaseStimulusSet() { setStimulusSet(std::unique_ptr<StimulusSet>(new StimulusSet)); }
+
+    /* takes effect at the next prepare() */
+    void setCrossfade(double fadeMs, crossfadeShapeEnum shape, int loopFadeSamples);
+
+    void setRouting(const RoutingMatrix &newRouting) { routing = newRouting; }
+
+    int getChannelCount() const { return channelCount; }
+
+    double getSampleRate() const { return sampleRate; }
+
+    /* Starts or stops queueing PlaybackEvents; off by default */
+    void setRecordingEvents(bool shouldRecord) { recordingEvents = shouldRecord; }
+
+    /* Queues the current position, loop and stimulus as command events, so that a log started
+       now can be replayed from a new engine.  Only while process() is not running. */
+    void recordState();
+
+    /* Queues a stop event; called once the device has stopped calling process() */
+    void recordStop();
+
+    /* Consumer side of the event queue */
+    bool popEvent(PlaybackEvent &event) { return eventQueue.pop(event); }
+
+    /* True if events were dropped because the queue was full, since the last call */
+    bool takeEventsLost() { return eventsLost.exchange(false); }
+
+    /* Samples rendered since the engine was created; events are stamped with this */
+    int64 getRenderedSamples() const { return renderedSamples.load(std::memory_order_acquire); }
+
+    /* Starts or stops queueing TimingEvents; off by default */
+    void setRecordingTimings(bool shouldRecord) { recordingTimings = shouldRecord; }
+
+    /* Consumer side of the timing ring */
+    bool popTiming(TimingEvent &event) { return timingQueue.pop(event); }
+
+    /* True if timings were dropped because the ring was full, since the last call */
+    bool takeTimingsLost() { return timingsLost.exchange(false); }
+
+    /* Callbacks that overran their block or started more than two blocks after the one before,
+       while playing, since the last call.  Only counted while timings are recorded. */
+    int takeGlitchedCallbacks() { return glitchedCallbacks.exchange(0); }
+
+    /* whether playback is paused as the audio thread sees it; only from the thread calling process() */
+    bool isPausedOnAudioThread() const { return playerPaused; }
+
+    /* Samples rendered of a stimulus since the last call; from the message thread */
+    int64 takeListenedSamples(int stimulus) { return listening.takeSamples(stimulus); }
+
+    /* Ended auditions, in order; from the message thread */
+    bool popAudition(Audition &audition) { return listening.popAudition(audition); }
+
+    bool takeAuditionsLost() { return listening.takeAuditionsLost(); }
+
+    /* Ends the current audition; called once the device has stopped calling process() */
+    void endAudition() { listening.endAudition(); }
+
+    /* Renders a recorded log again with the stimuli set on this engine, in the block sizes the
+       device used, and passes every block to write.  Returns false if write did, or if the
+       log is inconsistent. */
+    bool replay(const PlaybackLog &log, int numOutputs,
+                const std::function<bool(const AudioBuffer<float> &, int)> &write);
+
+private:
+    /* consumer side of the command queue */
+    void applyPendingCommands();
+
+    void applyCommand(const PlayerCommand &command);
+
+    void publishState();
+
+    void recordEvent(const PlaybackEvent &event);
+
+    void recordTiming(TimingEvent::Type type, int64 postedTicks, int numSamples);
+
+    /* records the callback that is ending, classified as a glitch or not */
+    void recordCallback(int numSamples);
+
+    /* renders numSamples samples, blockOffset samples into the callback, into mixBuffer and
+       advances the playhead */
+    void renderBlock(int blockOffset, int numSamples);
+
+    /* reads numSamples samples of a stimulus from the playhead into dest, wrapping around the loop
+       as often as needed */
+    void readStimulus(int stimulus, AudioBuffer<float> &dest, int numSamples);
+
+    /* fades numSamples samples of dest, fadePosition samples into a fadeLength sample loop fade,
+       over to the samples leading up to the start of the loop */
+    void blendLoopHead(StimulusSource &source, AudioBuffer<float> &dest, int destStartSample, int fadePosition,
+                       int fadeLength, int numSamples);
+
+    int64 currentSample;
+    int64 startSample;
+    int64 endSample;
+    bool playInLoop;
+    int currentStimulus;
+    int nextStimulus;
+    bool playerPaused;
+    int channelCount;
+    std::unique_ptr <StimulusSet> stimulusSet;
+
+    /* set up in prepare() so that process() never allocates */
+    double sampleRate;
+    AudioBuffer<float> mixBuffer;
+    AudioBuffer<float> voiceBuffer;
+    RoutingMatrix routing;
+    Crossfader crossfader;
+    double crossfadeMs;
+    crossfadeShapeEnum crossfadeShape;
+    AudioBuffer<float> loopHeadBuffer;
+    HeapBlock<float> loopFadeInGains;
+    HeapBlock<float> loopFadeOutGains;
+    int loopCrossfadeSamples;
+    int pendingLoopCrossfadeSamples;    // from setCrossfade(), taken on by prepare()
+
+    PlayerCommandQueue commandQueue;
+    PlaybackStateSnapshot stateSnapshot;
+    uint32 appliedCommands;
+
+    bool recordingEvents;
+    PlaybackEventQueue eventQueue;
+    std::atomic<bool> eventsLost;
+    std::atomic <int64> renderedSamples;
+    int lastBlockSize;
+
+    bool recordingTimings;
+    TimingEventQueue timingQueue;
+    std::atomic<bool> timingsLost;
+    int64 callbackStartTicks;   // 0 outside process()
+    int64 lastCallbackStartTicks;       // 0 until a callback after prepare() was recorded
+    std::atomic<int> glitchedCallbacks;
+    int64 switchPostedTicks;    // when the switch still to be started was posted, or 0
+
+    ListeningTimeCounter listening;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaybackEngine);
+};
+
+#endif /* PLAYBACK_ENGINE_H */
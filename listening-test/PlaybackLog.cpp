@@ -0,0 +1,166 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "PlaybackLog.h"
+
+/* element names of the commands, in PlayerCommand::Type order */
+const String playerCommandNames[] = {
+        "switchStimulus",
+        "setSample",
+        "setFragmentStart",
+        "setFragmentEnd",
+        "setPlayLoop",
+        "pause",
+        "resume"
+};
+const int numPlayerCommandNames = (int) (sizeof(playerCommandNames) / sizeof(playerCommandNames[0]));
+
+PlaybackEventQueue::PlaybackEventQueue() :
+        fifo(queueSize) {
+}
+
+bool PlaybackEventQueue::push(const PlaybackEvent &event) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    events[size1 > 0 ? start1 : start2] = event;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool PlaybackEventQueue::pop(PlaybackEvent &event) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    event = events[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+PlaybackLog::PlaybackLog() :
+        sampleRate(0.0),
+        channelCount(0),
+        crossfadeMs(10.0),
+        crossfadeShape(CROSSFADE_SHAPE_LINEAR),
+        loopCrossfadeSamples(0),
+        streamed(false),
+        endSample(0),
+        complete(true) {
+}
+
+void PlaybackLog::saveToXml(XmlElement &parent) const {
+    XmlElement *logXml = parent.createNewChildElement("playbackLog");
+    logXml->setAttribute("sampleRate", sampleRate);
+    logXml->setAttribute("channels", channelCount);
+    logXml->setAttribute("crossfadeMs", crossfadeMs);
+    logXml->setAttribute("crossfadeShape", crossfadeShapes[crossfadeShape]);
+    logXml->setAttribute("loopCrossfadeSamples", loopCrossfadeSamples);
+    logXml->setAttribute("endSample", String(endSample));
+    if (streamed) {
+        logXml->setAttribute("streamed", "1");
+    }
+    if (!complete) {
+        logXml->setAttribute("complete", "0");
+    }
+
+    /* gains are written with full precision, so that renders match the live output bit for bit */
+    for (int i = 0; i < fileNames.size(); i++) {
+        XmlElement *stimulusXml = logXml->createNewChildElement("stimulus");
+        stimulusXml->setAttribute("fileName", fileNames[i]);
+        stimulusXml->setAttribute("gain", (double) gains[i]);
+    }
+    routing.saveToXml(*logXml);
+
+    XmlElement *eventsXml = logXml->createNewChildElement("events");
+    for (int i = 0; i < events.size(); i++) {
+        const PlaybackEvent &event = events.getReference(i);
+        XmlElement *eventXml;
+        switch (event.type) {
+            case PlaybackEvent::prepare:
+                eventXml = eventsXml->createNewChildElement("prepare");
+                eventXml->setAttribute("sampleRate", event.sampleRate);
+                eventXml->setAttribute("blockSize", event.blockSize);
+                break;
+            case PlaybackEvent::blockSize:
+                eventXml = eventsXml->createNewChildElement("blockSize");
+                eventXml->setAttribute("size", event.blockSize);
+                break;
+            case PlaybackEvent::stop:
+                eventXml = eventsXml->createNewChildElement("stop");
+                break;
+            default:
+                eventXml = eventsXml->createNewChildElement(playerCommandNames[event.playerCommand.type]);
+                eventXml->setAttribute("value", String(event.playerCommand.value));
+                break;
+        }
+        eventXml->setAttribute("sample", String(event.sample));
+    }
+}
+
+String PlaybackLog::loadFromXml(const XmlElement &logXml) {
+    sampleRate = logXml.getDoubleAttribute("sampleRate");
+    channelCount = logXml.getIntAttribute("channels");
+    crossfadeMs = logXml.getDoubleAttribute("crossfadeMs", 10.0);
+    crossfadeShape = getCrossfadeShapeEnum(logXml.getStringAttribute("crossfadeShape"));
+    loopCrossfadeSamples = logXml.getIntAttribute("loopCrossfadeSamples");
+    endSample = logXml.getStringAttribute("endSample").getLargeIntValue();
+    complete = logXml.getBoolAttribute("complete", true);
+    streamed = logXml.getBoolAttribute("streamed", false);
+    if (sampleRate <= 0.0 || channelCount <= 0)
+        return "A <playbackLog> needs a sampleRate and a channel count";
+
+    fileNames.clear();
+    gains.clear();
+    routing = RoutingMatrix();
+    events.clear();
+
+    for (int i = 0; i < logXml.getNumChildElements(); i++) {
+        const XmlElement *child = logXml.getChildElement(i);
+        if (child->hasTagName("stimulus")) {
+            fileNames.add(child->getStringAttribute("fileName"));
+            gains.add((float) child->getDoubleAttribute("gain", 1.0));
+        } else if (child->hasTagName("routing")) {
+            const String error(routing.loadFromXml(*child));
+            if (error.isNotEmpty())
+                return error;
+        }
+    }
+
+    const XmlElement *eventsXml = logXml.getChildByName("events");
+    for (int i = 0; eventsXml != nullptr && i < eventsXml->getNumChildElements(); i++) {
+        const XmlElement *eventXml = eventsXml->getChildElement(i);
+        PlaybackEvent event = {};
+        event.sample = eventXml->getStringAttribute("sample").getLargeIntValue();
+
+        if (eventXml->hasTagName("prepare")) {
+            event.type = PlaybackEvent::prepare;
+            event.sampleRate = eventXml->getDoubleAttribute("sampleRate");
+            event.blockSize = eventXml->getIntAttribute("blockSize");
+        } else if (eventXml->hasTagName("blockSize")) {
+            event.type = PlaybackEvent::blockSize;
+            event.blockSize = eventXml->getIntAttribute("size");
+        } else if (eventXml->hasTagName("stop")) {
+            event.type = PlaybackEvent::stop;
+        } else {
+            int command = 0;
+            while (command < numPlayerCommandNames && !eventXml->hasTagName(playerCommandNames[command])) {
+                command++;
+            }
+            if (command == numPlayerCommandNames)
+                return "Unknown playback event <" + eventXml->getTagName() + ">";
+
+            event.type = PlaybackEvent::command;
+            event.playerCommand.type = static_cast<PlayerCommand::Type>(command);
+            event.playerCommand.value = eventXml->getStringAttribute("value").getLargeIntValue();
+        }
+        events.add(event);
+    }
+
+    return String();
+}
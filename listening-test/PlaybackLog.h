@@ -0,0 +1,88 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef PLAYBACK_LOG_H
+#define PLAYBACK_LOG_H
+
+#include <JuceHeader.h>
+#include "PlayerCommands.h"
+#include "PlaybackSettings.h"
+#include "RoutingMatrix.h"
+
+/**
+    Something that changed what the PlaybackEngine renders, stamped with the number of
+    samples the engine had rendered when it happened.
+*/
+struct PlaybackEvent {
+    enum Type {
+        command,    // a PlayerCommand was applied
+        prepare,    // the device started, at sampleRate with blocks of blockSize
+        blockSize,  // the device callbacks are blockSize samples long from here on
+        stop        // the device stopped
+    };
+
+    Type type;
+    int64 sample;
+    PlayerCommand playerCommand;
+    int blockSize;
+    double sampleRate;
+};
+
+/**
+    Single-producer, single-consumer lock-free queue of PlaybackEvents, filled by the audio
+    thread and emptied by the message thread.
+*/
+class PlaybackEventQueue {
+public:
+    PlaybackEventQueue();
+
+    /* Producer side; returns false if the queue is full */
+    bool push(const PlaybackEvent &event);
+
+    /* Consumer side; returns false if the queue is empty */
+    bool pop(PlaybackEvent &event);
+
+private:
+    enum {
+        queueSize = 1024
+    };
+
+    AbstractFifo fifo;
+    PlaybackEvent events[queueSize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaybackEventQueue);
+};
+
+/**
+    Everything needed to render again what was played from one set of stimuli: the files in
+    the order the commands refer to them, how they were played and the events, from the moment
+    the set was installed.  Stored in the results as a <playbackLog> element of the trial.
+*/
+class PlaybackLog {
+public:
+    PlaybackLog();
+
+    void saveToXml(XmlElement &parent) const;
+
+    /* Returns an empty string on success or the error message */
+    String loadFromXml(const XmlElement &logXml);
+
+    double sampleRate;
+    int channelCount;
+    StringArray fileNames;      // in stimulus order, without their directory
+    Array<float> gains;
+    RoutingMatrix routing;      // resolved, including the station routing
+    double crossfadeMs;
+    crossfadeShapeEnum crossfadeShape;
+    int loopCrossfadeSamples;
+    bool streamed;              // the stimuli were streamed from disk, so some may have played silence
+
+    Array <PlaybackEvent> events;
+    int64 endSample;            // samples rendered when the log was last brought up to date
+    bool complete;              // false if events were lost because the queue overflowed
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaybackLog);
+};
+
+#endif /* PLAYBACK_LOG_H */
@@ -0,0 +1,141 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "PlaybackRenderer.h"
+#include "StimulusSet.h"
+#include "Trial.h"
+
+PlaybackRenderer::PlaybackRenderer() :
+        Thread("Playback renderer"),
+        fileLogger(FileLogger::createDefaultAppLogger("ListeningTest", "listening-test.log.txt", String(), 0)) {
+}
+
+PlaybackRenderer::~PlaybackRenderer() {
+    stopThread(10000);
+}
+
+String PlaybackRenderer::renderResults(const File &resultsFileToRender, const File &outputDirectoryToUse) {
+    resultsFile = resultsFileToRender;
+    outputDirectory = outputDirectoryToUse;
+    warnings.clear();
+
+    /* the loader needs a Thread to ask whether it should stop */
+    startThread();
+    waitForThreadToExit(-1);
+    return lastError;
+}
+
+void PlaybackRenderer::run() {
+    lastError = renderAll();
+    if (lastError.isNotEmpty()) {
+        fileLogger->logMessage("Rendering " + resultsFile.getFullPathName() + " failed: " + lastError);
+    }
+}
+
+String PlaybackRenderer::renderAll() {
+    std::unique_ptr <XmlElement> results(parseXML(resultsFile));
+    if (results == nullptr)
+        return "Could not parse xml in " + resultsFile.getFullPathName();
+
+    const XmlElement *info = results->getChildByName("info");
+    const XmlElement *trialsXml = results->getChildByName("trials");
+    if (info == nullptr || trialsXml == nullptr)
+        return "Could not find the test info and trials in " + resultsFile.getFullPathName();
+
+    /* decode everything into memory, so that nothing plays silence while waiting for the disk as
+       a stream could; the gains come from the logs rather than from measuring again */
+    PlaybackSettings settings;
+    settings.loadFromXml(*info);
+    settings.stimulusStorage = STIMULUS_STORAGE_MEMORY;
+    settings.loudness = LOUDNESS_OFF;
+
+    const File stimuliDirectory(info->getStringAttribute("stimuliDirectory"));
+    const Result created(outputDirectory.createDirectory());
+    if (created.failed())
+        return created.getErrorMessage();
+
+    TimeSliceThread streamingThread("Stimulus streaming");
+    StimulusCache cache;
+    StimulusLoader loader(settings, streamingThread, cache, *fileLogger);
+    int numRendered = 0;
+
+    for (int t = 0; t < trialsXml->getNumChildElements(); t++) {
+        const XmlElement *trialXml = trialsXml->getChildElement(t);
+        const String trialName(trialXml->getStringAttribute("trialName"));
+        int logIndex = 0;
+
+        for (int i = 0; i < trialXml->getNumChildElements() && !threadShouldExit(); i++) {
+            if (!trialXml->getChildElement(i)->hasTagName("playbackLog"))
+                continue;
+
+            PlaybackLog log;
+            String error(log.loadFromXml(*trialXml->getChildElement(i)));
+            if (error.isNotEmpty())
+                return trialName + ": " + error;
+            if (!log.complete) {
+                warnings.add("Some playback events of " + trialName + " were lost; its render may differ");
+                fileLogger->logMessage(warnings[warnings.size() - 1]);
+            }
+            if (log.streamed) {
+                warnings.add(trialName + " was streamed from disk; silence played while the read-ahead ran out "
+                                         "is not in its render");
+                fileLogger->logMessage(warnings[warnings.size() - 1]);
+            }
+
+            Trial trial;
+            for (int f = 0; f < log.fileNames.size(); f++) {
+                trial.soundFiles.add(stimuliDirectory.getChildFile(trialName).getChildFile(log.fileNames[f])
+                                             .getFullPathName());
+            }
+
+            std::unique_ptr <StimulusSet> set(new StimulusSet);
+            loader.setTargetSampleRate(log.sampleRate);
+            error = loader.load(trial, *this, [](double) {}, *set);
+            if (error.isNotEmpty())
+                return trialName + ": " + error;
+            if (set->channelCount != log.channelCount || set->sampleRate != log.sampleRate)
+                return trialName + ": the stimuli no longer match the ones that were played";
+            set->gains = log.gains;
+
+            const int numOutputs = log.routing.getNumOutputsNeeded(log.channelCount);
+            const File wavFile(outputDirectory.getChildFile(
+                    File::createLegalFileName(trialName + "_" + String(++logIndex) + ".wav")));
+            wavFile.deleteFile();
+            std::unique_ptr <FileOutputStream> stream(wavFile.createOutputStream());
+            std::unique_ptr <AudioFormatWriter> writer;
+            if (stream != nullptr) {
+                WavAudioFormat wavFormat;
+                writer.reset(wavFormat.createWriterFor(stream.get(), log.sampleRate, (unsigned int) numOutputs, 32,
+                                                       StringPairArray(), 0));
+            }
+            if (writer == nullptr)
+                return "Cannot write " + wavFile.getFullPathName();
+            stream.release();
+
+            error = render(log, std::move(set), *writer);
+            if (error.isNotEmpty())
+                return trialName + ": " + error;
+
+            fileLogger->logMessage("Rendered the playback of " + trialName + " to " + wavFile.getFullPathName());
+            numRendered++;
+        }
+    }
+
+    if (numRendered == 0)
+        return "There is no playback log in " + resultsFile.getFullPathName();
+    return String();
+}
+
+String PlaybackRenderer::render(const PlaybackLog &log, std::unique_ptr <StimulusSet> stimuli,
+                                AudioFormatWriter &writer) {
+    PlaybackEngine engine;
+    engine.setStimulusSet(std::move(stimuli));
+
+    const bool written = engine.replay(log, (int) writer.getNumChannels(),
+                                       [&writer](const AudioBuffer<float> &outputs, int numSamples) {
+                                           return writer.writeFromFloatArrays(outputs.getArrayOfReadPointers(),
+                                                                              outputs.getNumChannels(), numSamples);
+                                       });
+    return written ? String() : "Cannot write the rendered audio";
+}
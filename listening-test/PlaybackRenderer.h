@@ -0,0 +1,53 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef PLAYBACK_RENDERER_H
+#define PLAYBACK_RENDERER_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PlaybackEngine.h"
+#include "PlaybackLog.h"
+
+/**
+    Renders the playback logs of a results file again, offline and as fast as the machine
+    allows.  The events are replayed through a PlaybackEngine with the same stimuli, gains,
+    routing and block sizes as live, so every file holds exactly the samples the listener's
+    device was given.  Each log becomes a 32 bit float WAV file named after its trial.
+
+    Stimuli are always rendered from memory.  Where a streamed stimulus ran out of read-ahead
+    the listener heard silence, which the log does not record, so renders of streamed trials
+    hold the stimulus there instead; getWarnings() names them.
+*/
+class PlaybackRenderer : private Thread {
+public:
+    PlaybackRenderer();
+
+    ~PlaybackRenderer();
+
+    /* Renders every log in resultsFile into outputDirectory.  Returns an empty string on
+       success or the error message. */
+    String renderResults(const File &resultsFile, const File &outputDirectory);
+
+    /* the renders of the last renderResults() that may differ from what was heard, one line each */
+    const StringArray &getWarnings() const { return warnings; }
+
+    /* Replays log through an engine playing stimuli, writing the outputs to writer.  Returns an
+       empty string on success or the error message. */
+    static String render(const PlaybackLog &log, std::unique_ptr <StimulusSet> stimuli, AudioFormatWriter &writer);
+
+private:
+    void run() override;
+
+    String renderAll();
+
+    File resultsFile;
+    File outputDirectory;
+    String lastError;
+    StringArray warnings;
+    std::unique_ptr <FileLogger> fileLogger;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaybackRenderer);
+};
+
+#endif /* PLAYBACK_RENDERER_H */
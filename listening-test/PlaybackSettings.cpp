@@ -0,0 +1,85 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "PlaybackSettings.h"
+
+const stimulusStorageEnum getStimulusStorageEnum(String stimulusStorageString) {
+    for (int i = 0; i < NUMBER_OF_STIMULUS_STORAGE_TYPES; i++) {
+        if (stimulusStorageTypes[i].equalsIgnoreCase(stimulusStorageString)) {
+            return static_cast<stimulusStorageEnum>(i);
+        }
+    }
+    return STIMULUS_STORAGE_MEMORY;
+}
+
+const sampleFormatEnum getSampleFormatEnum(String sampleFormatString) {
+    for (int i = 0; i < NUMBER_OF_SAMPLE_FORMATS; i++) {
+        if (sampleFormats[i].equalsIgnoreCase(sampleFormatString)) {
+            return static_cast<sampleFormatEnum>(i);
+        }
+    }
+    return SAMPLE_FORMAT_FLOAT;
+}
+
+const crossfadeShapeEnum getCrossfadeShapeEnum(String crossfadeShapeString) {
+    for (int i = 0; i < NUMBER_OF_CROSSFADE_SHAPES; i++) {
+        if (crossfadeShapes[i].equalsIgnoreCase(crossfadeShapeString)) {
+            return static_cast<crossfadeShapeEnum>(i);
+        }
+    }
+    return CROSSFADE_SHAPE_LINEAR;
+}
+
+const loudnessEnum getLoudnessEnum(String loudnessString) {
+    for (int i = 0; i < NUMBER_OF_LOUDNESS_MODES; i++) {
+        if (loudnessModes[i].equalsIgnoreCase(loudnessString)) {
+            return static_cast<loudnessEnum>(i);
+        }
+    }
+    return LOUDNESS_OFF;
+}
+
+int PlaybackSettings::getMaxPackedBytesPerSample() const {
+    switch (sampleFormat) {
+        case SAMPLE_FORMAT_INT16:
+            return 2;
+        case SAMPLE_FORMAT_INT24:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+void PlaybackSettings::loadFromXml(const XmlElement &xml) {
+    stimulusStorage = getStimulusStorageEnum(xml.getStringAttribute("stimulusStorage",
+                                                                    stimulusStorageTypes[STIMULUS_STORAGE_MEMORY]));
+    stimulusCacheMB = jmax(0, xml.getIntAttribute("stimulusCacheMB", 1024));
+    sampleFormat = getSampleFormatEnum(xml.getStringAttribute("sampleFormat", sampleFormats[SAMPLE_FORMAT_FLOAT]));
+    crossfadeMs = jlimit(0.0, 1000.0, xml.getDoubleAttribute("crossfadeMs", 10.0));
+    crossfadeShape = getCrossfadeShapeEnum(xml.getStringAttribute("crossfadeShape",
+                                                                  crossfadeShapes[CROSSFADE_SHAPE_LINEAR]));
+    loopCrossfadeSamples = jlimit(0, 65536, xml.getIntAttribute("loopCrossfadeSamples", 256));
+    loudness = getLoudnessEnum(xml.getStringAttribute("loudness", loudnessModes[LOUDNESS_OFF]));
+    targetLoudness = xml.getDoubleAttribute("targetLoudness", -23.0);
+    truePeakCeiling = xml.getDoubleAttribute("truePeakCeiling", -1.0);
+
+    routing = RoutingMatrix();
+    routingError = String();
+    if (const XmlElement *routingXml = xml.getChildByName("routing")) {
+        routingError = routing.loadFromXml(*routingXml);
+    }
+}
+
+void PlaybackSettings::saveToXml(XmlElement &xml) const {
+    xml.setAttribute("stimulusStorage", stimulusStorageTypes[stimulusStorage]);
+    xml.setAttribute("stimulusCacheMB", stimulusCacheMB);
+    xml.setAttribute("sampleFormat", sampleFormats[sampleFormat]);
+    xml.setAttribute("crossfadeMs", crossfadeMs);
+    xml.setAttribute("crossfadeShape", crossfadeShapes[crossfadeShape]);
+    xml.setAttribute("loopCrossfadeSamples", loopCrossfadeSamples);
+    xml.setAttribute("loudness", loudnessModes[loudness]);
+    xml.setAttribute("targetLoudness", targetLoudness);
+    xml.setAttribute("truePeakCeiling", truePeakCeiling);
+    routing.saveToXml(xml);
+}
@@ -0,0 +1,120 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef PLAYBACK_SETTINGS_H
+#define PLAYBACK_SETTINGS_H
+
+#include <JuceHeader.h>
+#include "RoutingMatrix.h"
+
+typedef enum {
+    STIMULUS_STORAGE_MEMORY = 0,    // decode every stimulus of the trial into RAM
+    STIMULUS_STORAGE_STREAM,        // read stimuli from disk while playing
+    STIMULUS_STORAGE_MAPPED,        // memory-map PCM WAV files and convert while playing
+    NUMBER_OF_STIMULUS_STORAGE_TYPES
+} stimulusStorageEnum;
+
+// NO SPACES ALLOWED IN THESE NAMES!
+const String stimulusStorageTypes[] = {
+        "memory",
+        "stream",
+        "mapped"
+};
+
+const stimulusStorageEnum getStimulusStorageEnum(String stimulusStorageString);
+
+typedef enum {
+    SAMPLE_FORMAT_FLOAT = 0,        // decoded stimuli are kept as 32 bit float
+    SAMPLE_FORMAT_INT16,            // 16 bit files are kept as packed 16 bit integers
+    SAMPLE_FORMAT_INT24,            // 16 and 24 bit files are kept as packed integers of their own size
+    NUMBER_OF_SAMPLE_FORMATS
+} sampleFormatEnum;
+
+// NO SPACES ALLOWED IN THESE NAMES!
+const String sampleFormats[] = {
+        "float",
+        "int16",
+        "int24"
+};
+
+const sampleFormatEnum getSampleFormatEnum(String sampleFormatString);
+
+typedef enum {
+    CROSSFADE_SHAPE_LINEAR = 0,
+    CROSSFADE_SHAPE_EQUAL_POWER,
+    CROSSFADE_SHAPE_RAISED_COSINE,
+    NUMBER_OF_CROSSFADE_SHAPES
+} crossfadeShapeEnum;
+
+// NO SPACES ALLOWED IN THESE NAMES!
+const String crossfadeShapes[] = {
+        "linear",
+        "equalPower",
+        "raisedCosine"
+};
+
+const crossfadeShapeEnum getCrossfadeShapeEnum(String crossfadeShapeString);
+
+typedef enum {
+    LOUDNESS_OFF = 0,
+    LOUDNESS_MEASURE,
+    LOUDNESS_MATCH,
+    NUMBER_OF_LOUDNESS_MODES
+} loudnessEnum;
+
+// NO SPACES ALLOWED IN THESE NAMES!
+const String loudnessModes[] = {
+        "off",
+        "measure",
+        "match"
+};
+
+const loudnessEnum getLoudnessEnum(String loudnessString);
+
+/**
+    Per-test playback options.  They are read from optional attributes of the
+    test spec and copied into the "info" element of the results so that a
+    resumed test plays back the same way.
+*/
+class PlaybackSettings {
+public:
+    PlaybackSettings() : stimulusStorage(STIMULUS_STORAGE_MEMORY), stimulusCacheMB(1024),
+                         sampleFormat(SAMPLE_FORMAT_FLOAT), crossfadeMs(10.0), crossfadeShape(CROSSFADE_SHAPE_LINEAR),
+                         loopCrossfadeSamples(256), loudness(LOUDNESS_OFF), targetLoudness(-23.0),
+                         truePeakCeiling(-1.0) {};
+
+    void loadFromXml(const XmlElement &xml);
+
+    void saveToXml(XmlElement &xml) const;
+
+    stimulusStorageEnum stimulusStorage;
+
+    /* memory kept for decoded stimuli that later trials may reuse; 0 disables the cache */
+    int stimulusCacheMB;
+
+    /* how stimuli decoded into memory are stored; files that would lose bits stay float */
+    sampleFormatEnum sampleFormat;
+
+    /* largest packed sample size allowed by sampleFormat, 0 for float */
+    int getMaxPackedBytesPerSample() const;
+
+    /* length and shape of the fade when switching stimuli; 0 ms switches without a fade */
+    double crossfadeMs;
+    crossfadeShapeEnum crossfadeShape;
+
+    /* samples over which the end of a loop fades into its start; 0 splices them directly */
+    int loopCrossfadeSamples;
+
+    /* whether stimuli are measured, and matched to targetLoudness (LUFS) without letting their
+       true peak go above truePeakCeiling (dBTP) */
+    loudnessEnum loudness;
+    double targetLoudness;
+    double truePeakCeiling;
+
+    /* how stimulus channels map onto device outputs, from an optional <routing> child element */
+    RoutingMatrix routing;
+    String routingError;
+};
+
+#endif /* PLAYBACK_SETTINGS_H */
@@ -0,0 +1,72 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "PlayerCommands.h"
+
+PlayerCommandQueue::PlayerCommandQueue() :
+        fifo(queueSize) {
+}
+
+bool PlayerCommandQueue::push(const PlayerCommand &command) {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    commands[size1 > 0 ? start1 : start2] = command;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool PlayerCommandQueue::pop(PlayerCommand &command) {
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1)
+        return false;
+
+    command = commands[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+    return true;
+}
+
+//==============================================================================
+PlaybackStateSnapshot::PlaybackStateSnapshot() :
+        sequence(0),
+        currentSample(0),
+        currentStimulus(-1),
+        nextStimulus(-1),
+        paused(true),
+        appliedCommands(0) {
+}
+
+void PlaybackStateSnapshot::publish(const PlaybackState &state) {
+    const uint32 seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);   // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    currentSample.store(state.currentSample, std::memory_order_relaxed);
+    currentStimulus.store(state.currentStimulus, std::memory_order_relaxed);
+    nextStimulus.store(state.nextStimulus, std::memory_order_relaxed);
+    paused.store(state.paused, std::memory_order_relaxed);
+    appliedCommands.store(state.appliedCommands, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+PlaybackState PlaybackStateSnapshot::read() const {
+    PlaybackState state;
+    for (;;) {
+        const uint32 before = sequence.load(std::memory_order_acquire);
+
+        state.currentSample = currentSample.load(std::memory_order_relaxed);
+        state.currentStimulus = currentStimulus.load(std::memory_order_relaxed);
+        state.nextStimulus = nextStimulus.load(std::memory_order_relaxed);
+        state.paused = paused.load(std::memory_order_relaxed);
+        state.appliedCommands = appliedCommands.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && sequence.load(std::memory_order_relaxed) == before)
+            return state;
+    }
+}
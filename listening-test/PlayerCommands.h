@@ -0,0 +1,90 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef PLAYER_COMMANDS_H
+#define PLAYER_COMMANDS_H
+
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+    A change to the playback state requested by the UI and applied by the audio thread
+    at the start of a block.
+*/
+struct PlayerCommand {
+    enum Type {
+        switchStimulus,
+        setSample,
+        setFragmentStart,
+        setFragmentEnd,
+        setPlayLoop,
+        pause,
+        resume
+    };
+
+    Type type;
+    int64 value;        // a sample position, stimulus index or flag
+    int64 postedTicks;  // Time::getHighResolutionTicks() when posted, 0 if not timed
+};
+
+/**
+    Single-producer, single-consumer lock-free queue of PlayerCommands.  The message thread
+    pushes and the audio thread pops; neither ever waits for the other.
+*/
+class PlayerCommandQueue {
+public:
+    PlayerCommandQueue();
+
+    /* Producer side; returns false if the queue is full */
+    bool push(const PlayerCommand &command);
+
+    /* Consumer side; returns false if the queue is empty */
+    bool pop(PlayerCommand &command);
+
+private:
+    enum {
+        queueSize = 256
+    };
+
+    AbstractFifo fifo;
+    PlayerCommand commands[queueSize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerCommandQueue);
+};
+
+/**
+    What the audio thread is playing, as published at the end of each block.
+*/
+struct PlaybackState {
+    int64 currentSample;
+    int currentStimulus;
+    int nextStimulus;
+    bool paused;
+    uint32 appliedCommands; // number of PlayerCommands applied so far
+};
+
+/**
+    Seqlock holding the latest PlaybackState.  The single writer never waits; readers retry
+    only if they overlap a write, and never see a half-written state.
+*/
+class PlaybackStateSnapshot {
+public:
+    PlaybackStateSnapshot();
+
+    void publish(const PlaybackState &state);
+
+    PlaybackState read() const;
+
+private:
+    std::atomic <uint32> sequence;
+    std::atomic <int64> currentSample;
+    std::atomic<int> currentStimulus;
+    std::atomic<int> nextStimulus;
+    std::atomic<bool> paused;
+    std::atomic <uint32> appliedCommands;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaybackStateSnapshot);
+};
+
+#endif /* PLAYER_COMMANDS_H */
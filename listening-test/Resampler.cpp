@@ -0,0 +1,112 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "Resampler.h"
+#include "SampleKernels.h"
+
+const double kaiserBeta = 9.0;
+const double passband = 0.95;   // of the lower Nyquist frequency
+
+/* zeroth order modified Bessel function of the first kind, for the Kaiser window */
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50 && term > sum * 1e-12; k++) {
+        const double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+static int64 greatestCommonDivisor(int64 a, int64 b) {
+    while (b != 0) {
+        const int64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+//==============================================================================
+Resampler::Resampler(double sourceSampleRate, double targetSampleRate) {
+    /* sample rates are whole numbers of Hz in practice */
+    const int64 source = jmax((int64) 1, (int64) roundToInt(sourceSampleRate));
+    const int64 target = jmax((int64) 1, (int64) roundToInt(targetSampleRate));
+    const int64 divisor = greatestCommonDivisor(source, target);
+    upFactor = target / divisor;
+    downFactor = source / divisor;
+    numPhases = (int) jmin(upFactor, (int64) maxPhases);
+
+    /* cutoff relative to the source Nyquist frequency; the filter gets longer as it gets narrower */
+    const double cutoff = passband * jmin(1.0, (double) upFactor / downFactor);
+    halfTaps = (int) std::ceil(zeroCrossings / jmin(1.0, (double) upFactor / downFactor));
+    numTaps = (2 * halfTaps + 3) & ~3;
+
+    filterBank.malloc((size_t) numPhases * numTaps);
+    const double windowScale = 1.0 / besselI0(kaiserBeta);
+    for (int phase = 0; phase < numPhases; phase++) {
+        const double fraction = (double) phase / numPhases;
+        float *taps = filterBank + (size_t) phase * numTaps;
+        double sum = 0.0;
+
+        /* tap k weighs input sample (index - halfTaps + 1 + k) for an output at index + fraction */
+        for (int k = 0; k < numTaps; k++) {
+            const double distance = k - halfTaps + 1 - fraction;
+            const double x = distance / (halfTaps + 1);
+            double h = 0.0;
+            if (std::abs(x) < 1.0) {
+                const double arg = MathConstants<double>::pi * cutoff * distance;
+                const double sinc = distance == 0.0 ? 1.0 : std::sin(arg) / arg;
+                h = cutoff * sinc * besselI0(kaiserBeta * std::sqrt(1.0 - x * x)) * windowScale;
+            }
+            taps[k] = (float) h;
+            sum += h;
+        }
+
+        /* unity gain at DC for every phase */
+        for (int k = 0; k < numTaps; k++) {
+            taps[k] = (float) (taps[k] / sum);
+        }
+    }
+}
+
+int64 Resampler::getResampledLength(int64 numSourceSamples, double sourceSampleRate, double targetSampleRate) {
+    const int64 source = jmax((int64) 1, (int64) roundToInt(sourceSampleRate));
+    const int64 target = jmax((int64) 1, (int64) roundToInt(targetSampleRate));
+    return (numSourceSamples * target + source - 1) / source;
+}
+
+SharedAudioBuffer Resampler::process(const AudioBuffer<float> &source, int numChannels, int numOutputSamples) const {
+    const int numSourceSamples = source.getNumSamples();
+    const int padding = numTaps;
+
+    std::shared_ptr <AudioBuffer<float>> dest(new AudioBuffer<float>(numChannels, numOutputSamples));
+
+    /* zero padding on both sides lets every output read a full set of taps */
+    HeapBlock<float> padded((size_t) numSourceSamples + 2 * padding, true);
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        FloatVectorOperations::copy(padded + padding, source.getReadPointer(ch), numSourceSamples);
+        float *out = dest->getWritePointer(ch);
+
+        for (int n = 0; n < numOutputSamples; n++) {
+            const int64 position = (int64) n * downFactor;
+            const int64 index = position / upFactor;
+            const int64 remainder = position % upFactor;
+            const int phase = numPhases == upFactor ? (int) remainder
+                                                    : (int) (remainder * numPhases / upFactor);
+
+            if (index >= numSourceSamples + halfTaps) {
+                FloatVectorOperations::clear(out + n, numOutputSamples - n);
+                break;
+            }
+
+            out[n] = dotProduct(filterBank + (size_t) phase * numTaps,
+                                padded + (padding + index - halfTaps + 1), numTaps);
+        }
+    }
+
+    return dest;
+}
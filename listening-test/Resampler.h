@@ -0,0 +1,45 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "StimulusSource.h"
+
+/**
+    Windowed-sinc polyphase sample rate converter, used on the loader threads to play stimuli
+    recorded at another rate than the device runs at.  The filter bank holds one Kaiser-windowed
+    sinc per output phase of the rational ratio between the rates (or per 1/maxPhases of a
+    sample when that ratio has too many phases), so each output sample is a single vectorized
+    dot product.  The cutoff follows the lower of the two rates, with about 90 dB of stopband
+    rejection.
+*/
+class Resampler {
+public:
+    Resampler(double sourceSampleRate, double targetSampleRate);
+
+    /* Length in samples of numSourceSamples samples once resampled */
+    static int64 getResampledLength(int64 numSourceSamples, double sourceSampleRate, double targetSampleRate);
+
+    /* Resamples the first numChannels channels of source into a new numOutputSamples long buffer */
+    SharedAudioBuffer process(const AudioBuffer<float> &source, int numChannels, int numOutputSamples) const;
+
+private:
+    enum {
+        maxPhases = 4096,
+        zeroCrossings = 24  // on each side of the filter, at the lower of the two rates
+    };
+
+    int64 upFactor;     // target rate over their greatest common divisor
+    int64 downFactor;   // source rate over their greatest common divisor
+    int numPhases;
+    int halfTaps;   // taps before the output position, and a few less than those after it
+    int numTaps;
+    HeapBlock<float> filterBank;  // numTaps coefficients for each phase
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Resampler);
+};
+
+#endif /* RESAMPLER_H */
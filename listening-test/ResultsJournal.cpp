@@ -0,0 +1,104 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "ResultsJournal.h"
+
+static const char journalMagic[] = "LTJR";
+
+ResultsJournal::ResultsJournal() {
+}
+
+ResultsJournal::~ResultsJournal() {
+    close();
+}
+
+String ResultsJournal::create(const File &file) {
+    close();
+
+    std::unique_ptr <FileOutputStream> stream(new FileOutputStream(file));
+    if (stream->failedToOpen())
+        return "Unable to open " + file.getFullPathName() + ": " + stream->getStatus().getErrorMessage();
+
+    stream->setPosition(0);
+    if (stream->truncate().failed())
+        return "Unable to empty " + file.getFullPathName();
+
+    stream->flush();
+    out = std::move(stream);
+    return String();
+}
+
+String ResultsJournal::append(const XmlElement &record) {
+    if (out == nullptr)
+        return "The results journal is not open";
+
+    const String text(record.toString(XmlElement::TextFormat().withoutHeader().singleLine()));
+    const size_t numBytes = text.getNumBytesAsUTF8();
+
+    out->write(journalMagic, 4);
+    out->writeInt((int) numBytes);
+    out->writeInt64(text.hashCode64());
+    out->write(text.toRawUTF8(), numBytes);
+
+    /* FileOutputStream::flush() also asks the OS to write its buffers to the disk (fsync) */
+    out->flush();
+    if (out->getStatus().failed())
+        return "Unable to write " + out->getFile().getFullPathName() + ": " + out->getStatus().getErrorMessage();
+
+    return String();
+}
+
+void ResultsJournal::close() {
+    out.reset();
+}
+
+bool ResultsJournal::read(const File &file, OwnedArray <XmlElement> &records) {
+    FileInputStream in(file);
+    if (in.failedToOpen())
+        return true;
+
+    while (!in.isExhausted()) {
+        char magic[4];
+        if (in.getNumBytesRemaining() < headerSize || in.read(magic, 4) != 4 || memcmp(magic, journalMagic, 4) != 0)
+            return false;
+
+        const int numBytes = in.readInt();
+        const int64 hash = in.readInt64();
+        if (numBytes < 0 || in.getNumBytesRemaining() < numBytes)
+            return false;
+
+        MemoryBlock bytes;
+        in.readIntoMemoryBlock(bytes, numBytes);
+        const String text(String::fromUTF8((const char *) bytes.getData(), (int) bytes.getSize()));
+        if (text.hashCode64() != hash)
+            return false;
+
+        std::unique_ptr <XmlElement> record(parseXML(text));
+        if (record == nullptr)
+            return false;
+        records.add(record.release());
+    }
+    return true;
+}
+
+String ResultsJournal::writeAtomically(const XmlElement &xml, const File &file) {
+    TemporaryFile temp(file, TemporaryFile::useHiddenFile);
+    {
+        FileOutputStream stream(temp.getFile());
+        if (stream.failedToOpen())
+            return "Unable to create " + temp.getFile().getFullPathName() + ": "
+                   + stream.getStatus().getErrorMessage();
+
+        xml.writeTo(stream);
+        stream.flush();
+        if (stream.getStatus().failed())
+            return "Unable to write " + temp.getFile().getFullPathName() + ": "
+                   + stream.getStatus().getErrorMessage();
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+        return "Unable to replace " + file.getFullPathName() + " with " + temp.getFile().getFullPathName();
+
+    return String();
+}
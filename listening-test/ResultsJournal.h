@@ -0,0 +1,56 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef RESULTS_JOURNAL_H
+#define RESULTS_JOURNAL_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <memory>
+
+/**
+    Append-only log of the changes to a results file since it was last written in full.  Each
+    record is an XmlElement, framed by the magic "LTJR", its length in bytes as 32 bits and a
+    64-bit hash of its text, and is on the disk before append() returns.  A record that a crash
+    cut short fails the check and is ignored when the journal is read back.
+*/
+class ResultsJournal {
+public:
+    ResultsJournal();
+
+    ~ResultsJournal();
+
+    /* Starts an empty journal in file, replacing any earlier one.  Returns an empty string on
+       success or the error message. */
+    String create(const File &file);
+
+    /* Writes record and waits until it is on the disk.  Returns an empty string on success or
+       the error message. */
+    String append(const XmlElement &record);
+
+    void close();
+
+    bool isOpen() const { return out != nullptr; }
+
+    File getFile() const { return out != nullptr ? out->getFile() : File(); }
+
+    /* Reads the complete records of file, oldest first, into records.  Returns false if the
+       last one was cut short, in which case it is left out. */
+    static bool read(const File &file, OwnedArray <XmlElement> &records);
+
+    /* Writes xml to a temporary file next to file and renames it over file, so that file holds
+       either the old or the new results, whenever the writing is interrupted.  Returns an empty
+       string on success or the error message. */
+    static String writeAtomically(const XmlElement &xml, const File &file);
+
+private:
+    enum {
+        headerSize = 16
+    };
+
+    std::unique_ptr <FileOutputStream> out;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResultsJournal);
+};
+
+#endif /* RESULTS_JOURNAL_H */
@@ -0,0 +1,299 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "ResultsReplicator.h"
+#include "TestTypes.h"
+
+static const char destinationFileName[] = "destination.txt";
+static const char confirmationExtension[] = ".copied";
+
+ResultsReplicator::ResultsReplicator(Logger &log) :
+        Thread("Results replicator"),
+        logger(log) {
+    startThread();
+}
+
+ResultsReplicator::~ResultsReplicator() {
+    signalThreadShouldExit();
+    notify();
+    stopThread(30000);
+}
+
+File ResultsReplicator::getSpoolRoot() {
+    return resultsSpoolDirectory;
+}
+
+File ResultsReplicator::getSpoolFile(const File &destination) {
+    const String directory(destination.getParentDirectory().getFullPathName());
+    return getSpoolRoot().getChildFile(String::toHexString(directory.hashCode64()))
+            .getChildFile(destination.getFileName());
+}
+
+String ResultsReplicator::prepareSpool(const File &destination) {
+    const File spoolDirectory(getSpoolFile(destination).getParentDirectory());
+    const Result res = spoolDirectory.createDirectory();
+    if (res.failed())
+        return "Unable to create " + spoolDirectory.getFullPathName() + ": " + res.getErrorMessage();
+
+    const File destinationFile(spoolDirectory.getChildFile(destinationFileName));
+    const String directory(destination.getParentDirectory().getFullPathName());
+    if (destinationFile.loadFileAsString() != directory && !destinationFile.replaceWithText(directory))
+        return "Unable to write " + destinationFile.getFullPathName();
+
+    return String();
+}
+
+File ResultsReplicator::getDestination(const File &spoolFile) {
+    const String directory(spoolFile.getParentDirectory().getChildFile(destinationFileName).loadFileAsString());
+    if (directory.isEmpty())
+        return File();
+
+    return File(directory).getChildFile(spoolFile.getFileName());
+}
+
+File ResultsReplicator::getNewestCopy(const File &destination) {
+    const File spoolFile(getSpoolFile(destination));
+    if (!spoolFile.existsAsFile() || getDestination(spoolFile) != destination)
+        return destination;
+
+    /* the results directory is only newer if results were written to it from another computer */
+    if (destination.existsAsFile() && destination.getLastModificationTime() > spoolFile.getLastModificationTime()) {
+        MemoryBlock spooled, copied;
+        if (spoolFile.loadFileAsData(spooled) && destination.loadFileAsData(copied) && spooled != copied)
+            return destination;
+    }
+    return spoolFile;
+}
+
+File ResultsReplicator::getConfirmationFile(const File &spoolFile) {
+    return spoolFile.getSiblingFile(spoolFile.getFileName() + confirmationExtension);
+}
+
+void ResultsReplicator::replicate(const File &spoolFile) {
+    {
+        const ScopedLock sl(lock);
+        const int index = findCopy(spoolFile);
+        if (index < 0) {
+            const Copy copy = {spoolFile, true, true, 0, String(), 0};
+            copies.add(copy);
+        } else {
+            /* a file waiting to be retried keeps waiting, so its failures still slow it down */
+            Copy &copy = copies.getReference(index);
+            copy.current = true;
+            copy.queued = true;
+        }
+    }
+    notify();
+    sendChangeMessage();
+}
+
+int ResultsReplicator::findCopy(const File &spoolFile) const {
+    for (int i = 0; i < copies.size(); i++) {
+        if (copies.getReference(i).spoolFile == spoolFile) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const ResultsReplicator::Copy *ResultsReplicator::findCurrentFailure() const {
+    for (int i = 0; i < copies.size(); i++) {
+        if (copies.getReference(i).current && copies.getReference(i).failures > 0) {
+            return &copies.getReference(i);
+        }
+    }
+    return nullptr;
+}
+
+int ResultsReplicator::getNumPending() {
+    const ScopedLock sl(lock);
+    return copies.size();
+}
+
+bool ResultsReplicator::isFailing() {
+    const ScopedLock sl(lock);
+    return findCurrentFailure() != nullptr;
+}
+
+String ResultsReplicator::getStatusText() {
+    const ScopedLock sl(lock);
+    const Copy *failure = findCurrentFailure();
+    if (failure != nullptr) {
+        String text("Results saved on this computer only; copying " + failure->spoolFile.getFileName() + " failed " +
+                    String(failure->failures) + " times (" + failure->error + ")");
+        if (failure->queued && failure->retryAt != 0) {
+            const int retryMs = jmax(0, (int) (failure->retryAt - Time::getMillisecondCounter()));
+            text << ", retrying in " << String(retryMs / 1000) << " s";
+        }
+        return text;
+    }
+    for (int i = 0; i < copies.size(); i++) {
+        if (copies.getReference(i).current) {
+            return "Copying results to the results directory...";
+        }
+    }
+    if (lastDestination != File()) {
+        return "Results copied to " + lastDestination.getParentDirectory().getFullPathName() + " at " +
+               lastCopied.toString(false, true);
+    }
+    return String();
+}
+
+void ResultsReplicator::run() {
+    queueUnconfirmed();
+
+    while (!threadShouldExit()) {
+        /* the first file that is not waiting to be retried, so one bad file does not hold up the others */
+        File spoolFile;
+        int waitMs = -1;
+        {
+            const ScopedLock sl(lock);
+            const uint32 now = Time::getMillisecondCounter();
+            for (int i = 0; i < copies.size() && spoolFile == File(); i++) {
+                Copy &copy = copies.getReference(i);
+                if (!copy.queued)
+                    continue;
+
+                const int untilRetryMs = copy.retryAt == 0 ? 0 : (int) (copy.retryAt - now);
+                if (untilRetryMs <= 0) {
+                    spoolFile = copy.spoolFile;
+                    copy.queued = false;
+                } else if (waitMs < 0 || untilRetryMs < waitMs) {
+                    waitMs = untilRetryMs;
+                }
+            }
+        }
+
+        if (spoolFile == File()) {
+            wait(waitMs);
+            continue;
+        }
+
+        bool retry = true;
+        const String error = copyToDestination(spoolFile, retry);
+        String message;
+        {
+            const ScopedLock sl(lock);
+            const int index = findCopy(spoolFile);
+            Copy &copy = copies.getReference(index);
+            if (error.isEmpty()) {
+                lastDestination = getDestination(spoolFile);
+                lastCopied = Time::getCurrentTime();
+
+                /* unless it was written again in the meantime */
+                if (copy.queued) {
+                    copy.failures = 0;
+                    copy.error = String();
+                    copy.retryAt = 0;
+                } else {
+                    copies.remove(index);
+                }
+            } else {
+                ++copy.failures;
+                copy.error = error;
+                if (retry) {
+                    const int retryMs = jmin((int) maxRetryMs, (int) firstRetryMs << jmin(copy.failures - 1, 6));
+                    copy.retryAt = jmax((uint32) 1, Time::getMillisecondCounter() + (uint32) retryMs);
+                    copy.queued = true;
+                    message = error + "; retrying in " + String(retryMs) + " ms";
+                } else {
+                    copy.retryAt = 0;
+                    message = error + "; skipped until it is written again";
+                }
+            }
+        }
+        sendChangeMessage();
+
+        if (message.isNotEmpty()) {
+            logger.logMessage(message);
+        }
+    }
+}
+
+void ResultsReplicator::queueUnconfirmed() {
+    /* whatever did not make it to its destination before the application last quit */
+    Array <File> spoolDirectories;
+    getSpoolRoot().findChildFiles(spoolDirectories, File::findDirectories, false);
+    for (int d = 0; d < spoolDirectories.size() && !threadShouldExit(); d++) {
+        Array <File> files;
+        spoolDirectories[d].findChildFiles(files, File::findFiles | File::ignoreHiddenFiles, false);
+        for (int i = 0; i < files.size(); i++) {
+            if (files[i].getFileName() == destinationFileName || files[i].getFileName().endsWith(confirmationExtension))
+                continue;
+
+            MemoryBlock data;
+            const String confirmed(getConfirmationFile(files[i]).loadFileAsString());
+            if (files[i].loadFileAsData(data) && confirmed == String::toHexString((int64) computeChecksum(data)))
+                continue;
+
+            const ScopedLock sl(lock);
+            if (findCopy(files[i]) < 0) {
+                const Copy copy = {files[i], false, true, 0, String(), 0};
+                copies.add(copy);
+            }
+        }
+    }
+    sendChangeMessage();
+}
+
+String ResultsReplicator::copyToDestination(const File &spoolFile, bool &retry) {
+    const File destination(getDestination(spoolFile));
+    if (destination == File()) {
+        retry = false;
+        return "No results directory is recorded for " + spoolFile.getFullPathName();
+    }
+
+    MemoryBlock data;
+    if (!spoolFile.existsAsFile())
+        return String();
+    if (!spoolFile.loadFileAsData(data))
+        return "Unable to read " + spoolFile.getFullPathName();
+
+    /* a results directory that was moved or deleted on purpose is not brought back */
+    if (!destination.getParentDirectory().isDirectory()) {
+        retry = false;
+        return "The results directory " + destination.getParentDirectory().getFullPathName() + " does not exist";
+    }
+
+    const uint64 checksum = computeChecksum(data);
+    const String confirmation(String::toHexString((int64) checksum));
+    MemoryBlock copied;
+    if (destination.existsAsFile() && destination.loadFileAsData(copied) && computeChecksum(copied) == checksum) {
+        getConfirmationFile(spoolFile).replaceWithText(confirmation);
+        return String();
+    }
+
+    TemporaryFile temp(destination, TemporaryFile::useHiddenFile);
+    {
+        FileOutputStream out(temp.getFile());
+        if (out.failedToOpen())
+            return "Unable to create " + temp.getFile().getFullPathName() + ": " + out.getStatus().getErrorMessage();
+
+        out.write(data.getData(), data.getSize());
+        out.flush();
+        if (out.getStatus().failed())
+            return "Unable to write " + temp.getFile().getFullPathName() + ": " + out.getStatus().getErrorMessage();
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+        return "Unable to replace " + destination.getFullPathName();
+
+    copied.reset();
+    if (!destination.loadFileAsData(copied) || computeChecksum(copied) != checksum)
+        return "The copy of " + destination.getFullPathName() + " does not match the results";
+
+    /* if this cannot be written, the file is only checked again at the next start */
+    getConfirmationFile(spoolFile).replaceWithText(confirmation);
+    return String();
+}
+
+uint64 ResultsReplicator::computeChecksum(const MemoryBlock &data) {
+    /* 64-bit FNV-1a */
+    uint64 hash = 14695981039346656037ULL;
+    const uint8 *bytes = static_cast<const uint8 *>(data.getData());
+    for (size_t i = 0; i < data.getSize(); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,101 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef RESULTS_REPLICATOR_H
+#define RESULTS_REPLICATOR_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+    Results are first written to a spool on the local disk, one directory per results
+    directory, and copied from there to the results directory on a background thread.  A copy
+    is written next to its destination and renamed over it, then read back and compared by
+    checksum; the checksum of a verified copy is kept next to the spooled file.  Failed copies
+    are retried, waiting longer after every failure of that file.  The results directory itself
+    is never created: while it is missing its files are skipped until they are written again.
+    At startup, the spooled files whose last verified copy does not match them are queued again.
+
+    The status only reflects the files written since the application started, so that a file
+    left over from an earlier test cannot make the current one look failed.  A change message
+    is sent whenever the status changes.
+*/
+class ResultsReplicator : public ChangeBroadcaster,
+                          private Thread {
+public:
+    ResultsReplicator(Logger &logger);
+
+    ~ResultsReplicator();
+
+    /* The local copy of destination, which may not exist yet */
+    static File getSpoolFile(const File &destination);
+
+    /* Creates the spool directory for destination.  Returns an empty string on success or the
+       error message. */
+    static String prepareSpool(const File &destination);
+
+    /* destination, or its local copy if that has not been copied there yet */
+    static File getNewestCopy(const File &destination);
+
+    /* Queues the spooled file to be copied to its destination */
+    void replicate(const File &spoolFile);
+
+    /* files waiting to be copied */
+    int getNumPending();
+
+    /* one line for the test owner, empty before any results were written */
+    String getStatusText();
+
+    /* true while copies of files written since the application started are failing */
+    bool isFailing();
+
+private:
+    struct Copy {
+        File spoolFile;
+        bool current;           // queued by replicate() since the application started
+        bool queued;            // false while being copied, and once skipped until written again
+        int failures;           // in a row
+        String error;
+        uint32 retryAt;         // Time::getMillisecondCounter(), 0 when not waiting to retry
+    };
+
+    void run() override;
+
+    /* queues the spooled files whose last verified copy does not match them */
+    void queueUnconfirmed();
+
+    /* Returns an empty string on success or the error message; retry is set to false if trying
+       again cannot help until the file is written again */
+    String copyToDestination(const File &spoolFile, bool &retry);
+
+    /* the index in copies of spoolFile, or -1 */
+    int findCopy(const File &spoolFile) const;
+
+    /* the first of copies written since the start whose copying failed, or nullptr */
+    const Copy *findCurrentFailure() const;
+
+    static File getDestination(const File &spoolFile);
+
+    /* where the checksum of the last verified copy of spoolFile is kept */
+    static File getConfirmationFile(const File &spoolFile);
+
+    static File getSpoolRoot();
+
+    static uint64 computeChecksum(const MemoryBlock &data);
+
+    enum {
+        firstRetryMs = 1000,
+        maxRetryMs = 60000
+    };
+
+    Logger &logger;
+
+    CriticalSection lock;
+    Array <Copy> copies;        // guarded by lock, the files not confirmed at their destination
+    File lastDestination;       // guarded by lock
+    Time lastCopied;            // guarded by lock
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResultsReplicator);
+};
+
+#endif /* RESULTS_REPLICATOR_H */
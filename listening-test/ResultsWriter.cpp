@@ -0,0 +1,164 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "ResultsWriter.h"
+
+ResultsWriter::ResultsWriter(Logger &log, ResultsReplicator &r) :
+        Thread("Results writer"),
+        logger(log),
+        replicator(r),
+        idle(true),
+        journalFailed(false) {
+    idle.signal();
+    startThread();
+}
+
+ResultsWriter::~ResultsWriter() {
+    signalThreadShouldExit();
+    notify();
+    stopThread(30000);
+}
+
+void ResultsWriter::writeResults(std::unique_ptr <XmlElement> results, const File &file, bool startJournal) {
+    Job *job = new Job;
+    job->append = false;
+    job->file = file;
+    job->startJournal = startJournal;
+    job->xml = std::move(results);
+
+    {
+        const ScopedLock sl(lock);
+        for (int i = jobs.size(); --i >= 0;) {
+            if (jobs[i]->file == file) {
+                jobs.remove(i);
+            }
+        }
+        jobs.add(job);
+        idle.reset();
+    }
+    notify();
+}
+
+void ResultsWriter::appendToJournal(std::unique_ptr <XmlElement> record, const File &file) {
+    {
+        const ScopedLock sl(lock);
+        Job *last = jobs.getLast();
+        if (last != nullptr && last->append && last->file == file) {
+            mergeRecord(*last->xml, *record);
+        } else {
+            Job *job = new Job;
+            job->append = true;
+            job->file = file;
+            job->startJournal = false;
+            job->xml = std::move(record);
+            jobs.add(job);
+        }
+        idle.reset();
+    }
+    notify();
+}
+
+bool ResultsWriter::waitUntilWritten(int timeoutMs) {
+    return idle.wait(timeoutMs);
+}
+
+String ResultsWriter::takeErrors() {
+    const ScopedLock sl(lock);
+    const String taken(errors);
+    errors = String();
+    return taken;
+}
+
+void ResultsWriter::run() {
+    for (;;) {
+        std::unique_ptr <Job> job;
+        {
+            const ScopedLock sl(lock);
+            if (jobs.size() > 0) {
+                job.reset(jobs.removeAndReturn(0));
+            } else {
+                idle.signal();
+            }
+        }
+
+        if (job != nullptr) {
+            perform(*job);
+        } else if (threadShouldExit()) {
+            break;
+        } else {
+            wait(-1);
+        }
+    }
+    journal.close();
+}
+
+void ResultsWriter::perform(Job &job) {
+    if (job.append) {
+        const String error = journal.append(*job.xml);
+        if (error.isNotEmpty()) {
+            journalFailed = true;
+            journal.close();
+            reportError(error);
+        } else {
+            replicator.replicate(journal.getFile());
+        }
+        return;
+    }
+
+    const File target(ResultsReplicator::getSpoolFile(job.file));
+    String error = ResultsReplicator::prepareSpool(job.file);
+    if (error.isEmpty()) {
+        error = ResultsJournal::writeAtomically(*job.xml, target);
+    }
+    if (error.isNotEmpty()) {
+        reportError(error);
+        return;
+    }
+    replicator.replicate(target);
+
+    /* the records of the old journal are all in the file now; those with a sequence up to its
+       journalSequence are skipped if a crash leaves them behind */
+    journal.close();
+    if (job.startJournal) {
+        const String journalError = journal.create(target.withFileExtension("journal"));
+        if (journalError.isNotEmpty()) {
+            logger.logMessage(journalError + "; the whole results file will be written after every trial");
+        } else {
+            replicator.replicate(journal.getFile());
+        }
+        journalFailed = journalError.isNotEmpty();
+    }
+}
+
+void ResultsWriter::reportError(const String &error) {
+    logger.logMessage(error);
+    {
+        const ScopedLock sl(lock);
+        errors += (errors.isEmpty() ? String() : String("\n")) + error;
+    }
+    sendChangeMessage();
+}
+
+void ResultsWriter::mergeRecord(XmlElement &into, const XmlElement &record) {
+    for (int i = 0; i < record.getNumAttributes(); i++) {
+        into.setAttribute(record.getAttributeName(i), record.getAttributeValue(i));
+    }
+
+    for (int i = 0; i < record.getNumChildElements(); i++) {
+        const XmlElement *update = record.getChildElement(i);
+        XmlElement *replacement = new XmlElement(*update);
+        XmlElement *queued = nullptr;
+        for (int j = 0; j < into.getNumChildElements() && queued == nullptr; j++) {
+            if (into.getChildElement(j)->getIntAttribute("index", -1) == update->getIntAttribute("index", -2)) {
+                queued = into.getChildElement(j);
+            }
+        }
+
+        if (queued != nullptr) {
+            into.replaceChildElement(queued, replacement);
+        } else {
+            into.addChildElement(replacement);
+        }
+    }
+}
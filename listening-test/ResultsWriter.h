@@ -0,0 +1,81 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef RESULTS_WRITER_H
+#define RESULTS_WRITER_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ResultsJournal.h"
+#include "ResultsReplicator.h"
+#include <atomic>
+#include <memory>
+
+/**
+    Writes results files and their journals to the local spool on a background thread, and has
+    the ResultsReplicator copy them to the results directory from there, so that a slow disk or
+    network share never holds up the interface.  The message thread hands over finished XML
+    snapshots, which are never touched again, and only waits for them in waitUntilWritten().
+    Writes that queue up behind a slow one are coalesced.  Errors are kept for takeErrors() and
+    announced with a change message.
+*/
+class ResultsWriter : public ChangeBroadcaster,
+                      private Thread {
+public:
+    ResultsWriter(Logger &logger, ResultsReplicator &replicator);
+
+    /* Writes out everything still queued first */
+    ~ResultsWriter();
+
+    /* Queues results to replace the contents of file: its copy in the spool is replaced in one
+       step and then copied to file.  Queued writes to file that have not started are dropped,
+       as results hold all of them.  With startJournal, an empty journal is started next to it
+       once it is written. */
+    void writeResults(std::unique_ptr <XmlElement> results, const File &file, bool startJournal);
+
+    /* Queues record for the journal of file.  If the last record queued has not been written
+       yet, record is merged into it. */
+    void appendToJournal(std::unique_ptr <XmlElement> record, const File &file);
+
+    /* Waits until everything queued is written, or for at most timeoutMs if that is not -1;
+       returns false if it timed out */
+    bool waitUntilWritten(int timeoutMs);
+
+    /* false once the journal could not be written, until writeResults() starts a new one */
+    bool isJournalUsable() const { return !journalFailed; }
+
+    /* the errors since the last call, one per line */
+    String takeErrors();
+
+private:
+    struct Job {
+        bool append;
+        File file;
+        bool startJournal;
+        std::unique_ptr <XmlElement> xml;
+    };
+
+    void run() override;
+
+    void perform(Job &job);
+
+    void reportError(const String &error);
+
+    /* makes the trial updates and attributes of record those of into */
+    static void mergeRecord(XmlElement &into, const XmlElement &record);
+
+    Logger &logger;
+    ResultsReplicator &replicator;
+
+    CriticalSection lock;
+    OwnedArray <Job> jobs;      // guarded by lock
+    String errors;              // guarded by lock
+    WaitableEvent idle;         // signalled while jobs is empty and nothing is being written
+
+    ResultsJournal journal;     // writer thread
+    std::atomic<bool> journalFailed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResultsWriter);
+};
+
+#endif /* RESULTS_WRITER_H */
@@ -0,0 +1,169 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "RoutingMatrix.h"
+
+const float minus3dB = 0.70710678f;
+
+RoutingMatrix::RoutingMatrix() :
+        identity(true),
+        stereoDownmix(false) {
+}
+
+String RoutingMatrix::loadFromXml(const XmlElement &routingXml) {
+    routes.clear();
+    identity = true;
+    stereoDownmix = false;
+
+    const String downmix(routingXml.getStringAttribute("downmix"));
+    if (downmix.isNotEmpty()) {
+        if (!downmix.equalsIgnoreCase("stereo"))
+            return "Unknown downmix \"" + downmix + "\" in <routing>; only \"stereo\" is supported";
+        stereoDownmix = true;
+        identity = false;
+    }
+
+    for (int i = 0; i < routingXml.getNumChildElements(); i++) {
+        const XmlElement *route = routingXml.getChildElement(i);
+        if (!route->hasTagName("route"))
+            continue;
+
+        if (stereoDownmix)
+            return "A <routing> element cannot have both a downmix and routes";
+
+        /* channels are numbered from 1 in the file */
+        const int input = route->getIntAttribute("input", 0) - 1;
+        const int output = route->getIntAttribute("output", 0) - 1;
+        if (input < 0 || output < 0)
+            return "Every <route> needs an input and an output channel, numbered from 1";
+
+        const float gain = route->hasAttribute("gainDb")
+                           ? Decibels::decibelsToGain((float) route->getDoubleAttribute("gainDb"), -200.0f)
+                           : (float) route->getDoubleAttribute("gain", 1.0);
+        addRoute(input, output, gain);
+        identity = false;
+    }
+
+    return String();
+}
+
+void RoutingMatrix::saveToXml(XmlElement &parent) const {
+    if (identity)
+        return;
+
+    XmlElement *routingXml = parent.createNewChildElement("routing");
+    if (stereoDownmix) {
+        routingXml->setAttribute("downmix", "stereo");
+    }
+    for (int i = 0; i < routes.size(); i++) {
+        XmlElement *route = routingXml->createNewChildElement("route");
+        route->setAttribute("input", routes[i].input + 1);
+        route->setAttribute("output", routes[i].output + 1);
+        route->setAttribute("gain", routes[i].gain);
+    }
+}
+
+RoutingMatrix RoutingMatrix::resolve(int numInputs, String &error) const {
+    if (!stereoDownmix)
+        return *this;
+
+    RoutingMatrix result;
+    result.identity = false;
+
+    if (numInputs == 1) {
+        result.addRoute(0, 0, minus3dB);
+        result.addRoute(0, 1, minus3dB);
+    } else if (numInputs == 2) {
+        result.identity = true;
+    } else if (numInputs == 6 || numInputs == 8 || numInputs == 10 || numInputs == 12) {
+        /* 5.1, 7.1, 5.1.4 and 7.1.4 in WAV order: L R C LFE, then left/right pairs of surrounds and
+           heights.  Centre and the pairs are folded in at -3 dB, as in ITU-R BS.775; LFE is dropped. */
+        result.addRoute(0, 0, 1.0f);
+        result.addRoute(1, 1, 1.0f);
+        result.addRoute(2, 0, minus3dB);
+        result.addRoute(2, 1, minus3dB);
+        for (int ch = 4; ch < numInputs; ch++) {
+            result.addRoute(ch, ch % 2, minus3dB);
+        }
+    } else {
+        error = "Cannot downmix stimuli with " + String(numInputs) + " channels to stereo";
+    }
+
+    return result;
+}
+
+RoutingMatrix RoutingMatrix::followedBy(const RoutingMatrix &next) const {
+    jassert(!stereoDownmix && !next.stereoDownmix); // resolve() both first
+
+    if (identity)
+        return next;
+    if (next.identity)
+        return *this;
+
+    RoutingMatrix result;
+    result.identity = false;
+    for (int i = 0; i < routes.size(); i++) {
+        for (int j = 0; j < next.routes.size(); j++) {
+            if (next.routes[j].input == routes[i].output) {
+                result.addRoute(routes[i].input, next.routes[j].output, routes[i].gain * next.routes[j].gain);
+            }
+        }
+    }
+    return result;
+}
+
+int RoutingMatrix::getNumOutputsNeeded(int numInputs) const {
+    if (identity)
+        return numInputs;
+
+    int numOutputs = 0;
+    for (int i = 0; i < routes.size(); i++) {
+        if (routes[i].input < numInputs) {
+            numOutputs = jmax(numOutputs, routes[i].output + 1);
+        }
+    }
+    return numOutputs;
+}
+
+void RoutingMatrix::process(const AudioBuffer<float> &source, int numInputs, float *const *outputs, int numOutputs,
+                            int outputStartSample, int numSamples) const {
+    if (identity) {
+        for (int ch = 0; ch < jmin(numInputs, numOutputs); ch++) {
+            if (outputs[ch] != nullptr) {
+                FloatVectorOperations::add(outputs[ch] + outputStartSample, source.getReadPointer(ch), numSamples);
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < routes.size(); i++) {
+        const Route &route = routes.getReference(i);
+        if (route.input >= numInputs || route.output >= numOutputs || outputs[route.output] == nullptr)
+            continue;
+
+        float *dest = outputs[route.output] + outputStartSample;
+        if (route.gain == 1.0f) {
+            FloatVectorOperations::add(dest, source.getReadPointer(route.input), numSamples);
+        } else {
+            FloatVectorOperations::addWithMultiply(dest, source.getReadPointer(route.input), route.gain, numSamples);
+        }
+    }
+}
+
+void RoutingMatrix::addRoute(int input, int output, float gain) {
+    int i = 0;
+    while (i < routes.size() && (routes[i].output < output || (routes[i].output == output && routes[i].input < input))) {
+        i++;
+    }
+
+    /* routes to the same place add up, and zero coefficients are not kept */
+    if (i < routes.size() && routes[i].output == output && routes[i].input == input) {
+        gain += routes[i].gain;
+        routes.remove(i);
+    }
+    if (gain != 0.0f) {
+        const Route route = {input, output, gain};
+        routes.insert(i, route);
+    }
+}
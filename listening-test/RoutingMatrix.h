@@ -0,0 +1,69 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef ROUTING_MATRIX_H
+#define ROUTING_MATRIX_H
+
+#include <JuceHeader.h>
+
+/**
+    Maps the channels of the stimuli onto the outputs of the audio device.  Only the
+    non-zero coefficients are stored, so a matrix costs one vector add per route.  Read
+    from a <routing> element such as
+
+        <routing downmix="stereo"/>
+
+    or, with channels numbered from 1,
+
+        <routing>
+            <route input="1" output="3"/>
+            <route input="3" output="3" gainDb="-3"/>
+        </routing>
+
+    A routing without routes or downmix sends input n to output n.
+*/
+class RoutingMatrix {
+public:
+    struct Route {
+        int input;
+        int output;
+        float gain;
+    };
+
+    RoutingMatrix();
+
+    bool isIdentity() const { return identity; }
+
+    /* Returns an empty string on success or the error message */
+    String loadFromXml(const XmlElement &routingXml);
+
+    /* Adds a <routing> element describing the matrix to parent, unless it is the identity */
+    void saveToXml(XmlElement &parent) const;
+
+    /* The concrete routes for a stimulus with numInputs channels, with the downmix preset
+       expanded for that layout.  Sets error if the layout is not supported. */
+    RoutingMatrix resolve(int numInputs, String &error) const;
+
+    /* The matrix that applies this one, then next */
+    RoutingMatrix followedBy(const RoutingMatrix &next) const;
+
+    /* Outputs a resolved matrix writes to when fed numInputs channels */
+    int getNumOutputsNeeded(int numInputs) const;
+
+    /* Adds numSamples samples of every routed source channel, scaled, into the output channels at
+       outputStartSample.  Outputs that are null or beyond numOutputs are skipped. */
+    void process(const AudioBuffer<float> &source, int numInputs, float *const *outputs, int numOutputs,
+                 int outputStartSample, int numSamples) const;
+
+private:
+    void addRoute(int input, int output, float gain);
+
+    Array <Route> routes;  // sorted by output, then input
+    bool identity;
+    bool stereoDownmix;
+
+    JUCE_LEAK_DETECTOR(RoutingMatrix);
+};
+
+#endif /* ROUTING_MATRIX_H */
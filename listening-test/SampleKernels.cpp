@@ -0,0 +1,154 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "SampleKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define LT_USE_SSE2 1
+ #if defined(__SSSE3__)
+  #include <tmmintrin.h>
+  #define LT_USE_SSSE3 1
+ #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+ #define LT_USE_NEON 1
+#endif
+
+const float int16Scale = 1.0f / 32768.0f;
+const float int24Scale = 1.0f / 8388608.0f;
+
+//==============================================================================
+void convertInt16ToFloat(const void *source, float *dest, int numSamples) {
+    const int16 *src = static_cast<const int16 *> (source);
+    int i = 0;
+
+#if LT_USE_SSE2
+    const __m128 scale = _mm_set1_ps(int16Scale);
+    for (; i + 8 <= numSamples; i += 8) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *> (src + i));
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif LT_USE_NEON
+    for (; i + 8 <= numSamples; i += 8) {
+        const int16x8_t s = vld1q_s16(src + i);
+        const int32x4_t lo = vmovl_s16(vget_low_s16(s));
+        const int32x4_t hi = vmovl_s16(vget_high_s16(s));
+        vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(lo), int16Scale));
+        vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(hi), int16Scale));
+    }
+#endif
+
+    for (; i < numSamples; i++) {
+        dest[i] = (float) src[i] * int16Scale;
+    }
+}
+
+//==============================================================================
+void convertInt24ToFloat(const void *source, float *dest, int numSamples) {
+    const uint8 *src = static_cast<const uint8 *> (source);
+    int i = 0;
+
+#if LT_USE_SSSE3
+    /* move each 3-byte sample into the top of a 32 bit lane, then shift it back down with sign extension */
+    const __m128i shuffle = _mm_setr_epi8(-128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(int24Scale);
+    for (; i + 6 <= numSamples; i += 4) {  // each load reads 16 bytes but consumes 12
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *> (src + i * 3));
+        const __m128i v = _mm_srai_epi32(_mm_shuffle_epi8(s, shuffle), 8);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#elif LT_USE_NEON
+    for (; i + 16 <= numSamples; i += 16) {
+        const uint8x16x3_t b = vld3q_u8(src + i * 3);  // low, middle and high bytes of 16 samples
+
+        const uint16x8_t lowWordsA = vorrq_u16(vmovl_u8(vget_low_u8(b.val[0])), vshll_n_u8(vget_low_u8(b.val[1]), 8));
+        const uint16x8_t lowWordsB = vorrq_u16(vmovl_u8(vget_high_u8(b.val[0])), vshll_n_u8(vget_high_u8(b.val[1]), 8));
+        const int16x8_t highWordsA = vmovl_s8(vreinterpret_s8_u8(vget_low_u8(b.val[2])));
+        const int16x8_t highWordsB = vmovl_s8(vreinterpret_s8_u8(vget_high_u8(b.val[2])));
+
+        const int32x4_t s0 = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(highWordsA)), 16),
+                                       vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lowWordsA))));
+        const int32x4_t s1 = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(highWordsA)), 16),
+                                       vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lowWordsA))));
+        const int32x4_t s2 = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(highWordsB)), 16),
+                                       vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lowWordsB))));
+        const int32x4_t s3 = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(highWordsB)), 16),
+                                       vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lowWordsB))));
+
+        vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(s0), int24Scale));
+        vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(s1), int24Scale));
+        vst1q_f32(dest + i + 8, vmulq_n_f32(vcvtq_f32_s32(s2), int24Scale));
+        vst1q_f32(dest + i + 12, vmulq_n_f32(vcvtq_f32_s32(s3), int24Scale));
+    }
+#endif
+
+    for (; i < numSamples; i++) {
+        const uint8 *s = src + i * 3;
+        const int32 v = (int32) (((uint32) s[0] << 8) | ((uint32) s[1] << 16) | ((uint32) s[2] << 24)) >> 8;
+        dest[i] = (float) v * int24Scale;
+    }
+}
+
+//==============================================================================
+void convertFloat32ToFloat(const void *source, float *dest, int numSamples) {
+    memcpy(dest, source, (size_t) numSamples * sizeof(float));
+}
+
+//==============================================================================
+void deinterleaveSamples(const float *source, float *const *dest, int numChannels, int numFrames) {
+    if (numChannels == 2) {
+        float *left = dest[0];
+        float *right = dest[1];
+        for (int i = 0; i < numFrames; i++) {
+            left[i] = source[2 * i];
+            right[i] = source[2 * i + 1];
+        }
+    } else {
+        for (int ch = 0; ch < numChannels; ch++) {
+            float *d = dest[ch];
+            const float *s = source + ch;
+            for (int i = 0; i < numFrames; i++) {
+                d[i] = s[i * numChannels];
+            }
+        }
+    }
+}
+
+//==============================================================================
+float dotProduct(const float *a, const float *b, int numSamples) {
+    float sum = 0.0f;
+    int i = 0;
+
+#if LT_USE_SSE2
+    /* two accumulators to hide the latency of the adds */
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= numSamples; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif LT_USE_NEON
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= numSamples; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, vaddq_f32(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+    for (; i < numSamples; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
@@ -0,0 +1,33 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef SAMPLE_KERNELS_H
+#define SAMPLE_KERNELS_H
+
+#include <JuceHeader.h>
+
+/*
+    Vectorized (SSE2/SSSE3 or NEON, with a scalar fallback) inner loops used on the audio and loader threads.
+    Integer conversions scale by 2^-15 and 2^-23, which gives exactly the floats JUCE's
+    AudioFormatReader produces for 16 and 24 bit files.
+*/
+
+typedef void (*SampleConverter)(const void *source, float *dest, int numSamples);
+
+/* little-endian 16 bit integers to float */
+void convertInt16ToFloat(const void *source, float *dest, int numSamples);
+
+/* packed little-endian 24 bit integers (3 bytes per sample) to float */
+void convertInt24ToFloat(const void *source, float *dest, int numSamples);
+
+/* little-endian 32 bit floats */
+void convertFloat32ToFloat(const void *source, float *dest, int numSamples);
+
+/* splits numFrames interleaved frames of numChannels samples into separate channels */
+void deinterleaveSamples(const float *source, float *const *dest, int numChannels, int numFrames);
+
+/* sum of a[i] * b[i] */
+float dotProduct(const float *a, const float *b, int numSamples);
+
+#endif /* SAMPLE_KERNELS_H */
@@ -0,0 +1,103 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "StimulusCache.h"
+
+StimulusCache::StimulusCache() :
+        memoryBudget(0),
+        cachedBytes(0) {
+}
+
+void StimulusCache::setMemoryBudget(int64 bytes) {
+    const ScopedLock sl(lock);
+    memoryBudget = bytes;
+    trim();
+}
+
+SharedAudioBuffer StimulusCache::find(const File &file, int numChannels, int numSamples, double resampledRate) {
+    const String key(makeKey(file, (int) sizeof(float), resampledRate));
+
+    const ScopedLock sl(lock);
+    Entry *entry = use(key);
+    if (entry == nullptr || entry->audio->getNumChannels() != numChannels ||
+        entry->audio->getNumSamples() < numSamples)
+        return nullptr;
+
+    return entry->audio;
+}
+
+SharedPackedAudio StimulusCache::findPacked(const File &file, int numChannels, int numSamples, int bytesPerSample) {
+    const String key(makeKey(file, bytesPerSample));
+
+    const ScopedLock sl(lock);
+    Entry *entry = use(key);
+    if (entry == nullptr || entry->packedAudio->numChannels != numChannels ||
+        entry->packedAudio->numSamples < numSamples)
+        return nullptr;
+
+    return entry->packedAudio;
+}
+
+void StimulusCache::add(const File &file, SharedAudioBuffer audio, double resampledRate) {
+    Entry *entry = new Entry;
+    entry->key = makeKey(file, (int) sizeof(float), resampledRate);
+    entry->bytes = (int64) audio->getNumChannels() * audio->getNumSamples() * (int64) sizeof(float);
+    entry->audio = std::move(audio);
+    add(entry);
+}
+
+void StimulusCache::add(const File &file, SharedPackedAudio audio) {
+    Entry *entry = new Entry;
+    entry->key = makeKey(file, audio->bytesPerSample);
+    entry->bytes = audio->getNumBytes();
+    entry->packedAudio = std::move(audio);
+    add(entry);
+}
+
+void StimulusCache::clear() {
+    const ScopedLock sl(lock);
+    entries.clear();
+    cachedBytes = 0;
+}
+
+String StimulusCache::makeKey(const File &file, int bytesPerSample, double resampledRate) {
+    String key(file.getFullPathName() + "|" + String(file.getLastModificationTime().toMilliseconds()) + "|" +
+               String(file.getSize()) + "|" + String(bytesPerSample));
+    if (resampledRate > 0.0) {
+        key << "@" << String(roundToInt(resampledRate));
+    }
+    return key;
+}
+
+StimulusCache::Entry *StimulusCache::use(const String &key) {
+    for (int i = 0; i < entries.size(); i++) {
+        if (entries.getUnchecked(i)->key == key) {
+            entries.move(i, -1);
+            return entries.getLast();
+        }
+    }
+    return nullptr;
+}
+
+void StimulusCache::add(Entry *entry) {
+    const ScopedLock sl(lock);
+    for (int i = 0; i < entries.size(); i++) {
+        if (entries.getUnchecked(i)->key == entry->key) {
+            cachedBytes -= entries.getUnchecked(i)->bytes;
+            entries.remove(i);
+            break;
+        }
+    }
+
+    entries.add(entry);
+    cachedBytes += entry->bytes;
+    trim();
+}
+
+void StimulusCache::trim() {
+    while (cachedBytes > memoryBudget && entries.size() > 0) {
+        cachedBytes -= entries.getFirst()->bytes;
+        entries.remove(0);
+    }
+}
@@ -0,0 +1,63 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef STIMULUS_CACHE_H
+#define STIMULUS_CACHE_H
+
+#include <JuceHeader.h>
+#include "StimulusSource.h"
+
+/**
+    Least-recently-used cache of decoded stimuli, so that a file used by several trials
+    (the BS.1116 reference, the files of AB pairs) is only decoded once per session.
+    Entries are keyed by path, modification time, size, storage format and, for audio converted
+    to the device rate, the sample rate it was converted to.  They are evicted once
+    the decoded audio exceeds the memory budget.  Audio still used by a trial stays alive
+    after eviction.  Thread-safe.
+*/
+class StimulusCache {
+public:
+    StimulusCache();
+
+    void setMemoryBudget(int64 bytes);
+
+    /* Return the decoded audio of file if it is cached in that format with numChannels channels
+       and at least numSamples samples, or nullptr.  A resampledRate other than 0 looks for the file
+       resampled to that rate instead of at its own rate. */
+    SharedAudioBuffer find(const File &file, int numChannels, int numSamples, double resampledRate = 0.0);
+
+    SharedPackedAudio findPacked(const File &file, int numChannels, int numSamples, int bytesPerSample);
+
+    void add(const File &file, SharedAudioBuffer audio, double resampledRate = 0.0);
+
+    void add(const File &file, SharedPackedAudio audio);
+
+    void clear();
+
+private:
+    struct Entry {
+        String key;
+        SharedAudioBuffer audio;
+        SharedPackedAudio packedAudio;
+        int64 bytes;
+    };
+
+    static String makeKey(const File &file, int bytesPerSample, double resampledRate = 0.0);
+
+    /* moves the entry to the most recently used end and returns it, or nullptr */
+    Entry *use(const String &key);
+
+    void add(Entry *entry);
+
+    void trim();
+
+    CriticalSection lock;
+    OwnedArray <Entry> entries; // least recently used first
+    int64 memoryBudget;
+    int64 cachedBytes;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StimulusCache);
+};
+
+#endif /* STIMULUS_CACHE_H */
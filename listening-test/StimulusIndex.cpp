@@ -0,0 +1,297 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "StimulusIndex.h"
+#include "TestTypes.h"
+
+StimulusIndex::StimulusIndex() {
+    formatManager.registerFormat(new WavAudioFormat(), true);
+}
+
+StimulusIndex::~StimulusIndex() {
+}
+
+bool StimulusIndex::update(const File &r) {
+    if (!r.isDirectory())
+        return false;
+
+    if (r != root) {
+        root = r;
+        directories.clear();
+        directoryLookup.clear();
+        load();
+    }
+
+    previous.swapWith(directories);
+    previousLookup.swapWith(directoryLookup);
+
+    bool changed = false;
+    scanDirectory(root, String(), changed);
+    if (directories.size() != previous.size()) {
+        changed = true;
+    }
+
+    previous.clear();
+    previousLookup.clear();
+
+    if (changed) {
+        save();
+    }
+    return true;
+}
+
+Array <File> StimulusIndex::getDirectories(bool recursive) const {
+    Array <File> found;
+    for (int i = 0; i < directories.size(); i++) {
+        const String &path = directories[i]->path;
+        if (path.isNotEmpty() && (recursive || !path.containsChar('/'))) {
+            found.add(root.getChildFile(path));
+        }
+    }
+    found.sort();
+    return found;
+}
+
+Array <File> StimulusIndex::getFiles(const File &directory, const String &wildcard) const {
+    Array <File> found;
+    const IndexedDirectory *entry = findDirectory(directory);
+    if (entry == nullptr)
+        return found;
+
+    for (int i = 0; i < entry->files.size(); i++) {
+        const String &name = entry->files.getReference(i).name;
+        if (name.matchesWildcard(wildcard, !File::areFileNamesCaseSensitive())) {
+            found.add(directory.getChildFile(name));
+        }
+    }
+    return found;
+}
+
+const StimulusIndex::IndexedFile *StimulusIndex::getFileInfo(const File &file) const {
+    const IndexedDirectory *entry = findDirectory(file.getParentDirectory());
+    if (entry == nullptr)
+        return nullptr;
+
+    for (int i = 0; i < entry->files.size(); i++) {
+        if (entry->files.getReference(i).name == file.getFileName()) {
+            return &entry->files.getReference(i);
+        }
+    }
+    return nullptr;
+}
+
+void StimulusIndex::scanDirectory(const File &directory, const String &path, bool &changed) {
+    IndexedDirectory *entry = new IndexedDirectory;
+    entry->path = path;
+    entry->modified = directory.getLastModificationTime().toMilliseconds();
+
+    const IndexedDirectory *known = previousLookup.contains(path) ? previous[previousLookup[path]] : nullptr;
+    if (known != nullptr && known->modified == entry->modified) {
+        entry->subdirectories = known->subdirectories;
+        entry->files = known->files;
+
+        /* a header that could not be read may have been caught mid-copy or over a flaky share */
+        for (int i = 0; i < entry->files.size(); i++) {
+            IndexedFile &file = entry->files.getReference(i);
+            if (file.numChannels == 0 && refresh(directory.getChildFile(file.name), file)) {
+                changed = true;
+            }
+        }
+    } else {
+        changed = true;
+
+        /* the iterator reports types, sizes and times from the listing itself, without a
+           request per file */
+        for (const DirectoryEntry &child : RangedDirectoryIterator(directory, false, "*",
+                                                                   File::findFilesAndDirectories)) {
+            const String name(child.getFile().getFileName());
+            if (child.isDirectory()) {
+                entry->subdirectories.add(name);
+                continue;
+            }
+
+            IndexedFile file;
+            file.name = name;
+            file.size = child.getFileSize();
+            file.modified = child.getModificationTime().toMilliseconds();
+            file.numChannels = 0;
+            file.sampleRate = 0.0;
+            file.lengthInSamples = 0;
+
+            const IndexedFile *knownFile = nullptr;
+            for (int i = 0; known != nullptr && i < known->files.size() && knownFile == nullptr; i++) {
+                if (known->files.getReference(i).name == name) {
+                    knownFile = &known->files.getReference(i);
+                }
+            }
+
+            if (knownFile != nullptr && knownFile->size == file.size && knownFile->modified == file.modified
+                && (knownFile->numChannels > 0 || !child.getFile().hasFileExtension("wav"))) {
+                file = *knownFile;
+            } else {
+                readHeader(child.getFile(), file);
+            }
+            entry->files.add(file);
+        }
+    }
+
+    directoryLookup.set(path, directories.size());
+    directories.add(entry);
+
+    /* a subdirectory may have changed even if this directory did not */
+    for (int i = 0; i < entry->subdirectories.size(); i++) {
+        const String &name = entry->subdirectories[i];
+        const File subdirectory(directory.getChildFile(name));
+        if (subdirectory.isDirectory()) {
+            scanDirectory(subdirectory, path.isEmpty() ? name : path + "/" + name, changed);
+        }
+    }
+}
+
+const StimulusIndex::IndexedFile *StimulusIndex::refreshFileInfo(const File &file) {
+    IndexedDirectory *entry = findDirectory(file.getParentDirectory());
+    if (entry == nullptr)
+        return nullptr;
+
+    for (int i = 0; i < entry->files.size(); i++) {
+        IndexedFile &indexed = entry->files.getReference(i);
+        if (indexed.name == file.getFileName()) {
+            if (refresh(file, indexed)) {
+                save();
+            }
+            return &indexed;
+        }
+    }
+    return nullptr;
+}
+
+bool StimulusIndex::refresh(const File &file, IndexedFile &entry) {
+    const int64 size = file.getSize();
+    const int64 modified = file.getLastModificationTime().toMilliseconds();
+    if (size == entry.size && modified == entry.modified && (entry.numChannels > 0 || !file.hasFileExtension("wav")))
+        return false;
+
+    IndexedFile updated;
+    updated.name = entry.name;
+    updated.size = size;
+    updated.modified = modified;
+    updated.numChannels = 0;
+    updated.sampleRate = 0.0;
+    updated.lengthInSamples = 0;
+    readHeader(file, updated);
+
+    const bool changed = updated.size != entry.size || updated.modified != entry.modified
+                         || updated.numChannels != entry.numChannels || updated.sampleRate != entry.sampleRate
+                         || updated.lengthInSamples != entry.lengthInSamples;
+    entry = updated;
+    return changed;
+}
+
+void StimulusIndex::readHeader(const File &file, IndexedFile &entry) {
+    if (!file.hasFileExtension("wav"))
+        return;
+
+    std::unique_ptr <AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr)
+        return;
+
+    entry.numChannels = (int) reader->numChannels;
+    entry.sampleRate = reader->sampleRate;
+    entry.lengthInSamples = reader->lengthInSamples;
+}
+
+const StimulusIndex::IndexedDirectory *StimulusIndex::findDirectory(const File &directory) const {
+    const int index = findDirectoryIndex(directory);
+    return index < 0 ? nullptr : directories.getUnchecked(index);
+}
+
+StimulusIndex::IndexedDirectory *StimulusIndex::findDirectory(const File &directory) {
+    const int index = findDirectoryIndex(directory);
+    return index < 0 ? nullptr : directories.getUnchecked(index);
+}
+
+int StimulusIndex::findDirectoryIndex(const File &directory) const {
+    if (directory != root && !directory.isAChildOf(root))
+        return -1;
+
+    const String path(directory == root ? String() :
+                      directory.getRelativePathFrom(root).replaceCharacter('\\', '/'));
+    if (!directoryLookup.contains(path))
+        return -1;
+
+    return directoryLookup[path];
+}
+
+void StimulusIndex::load() {
+    std::unique_ptr <XmlElement> indexXml(parseXML(getIndexFile()));
+    if (indexXml == nullptr || indexXml->getIntAttribute("version") != indexVersion ||
+        indexXml->getStringAttribute("root") != root.getFullPathName())
+        return;
+
+    for (int d = 0; d < indexXml->getNumChildElements(); d++) {
+        const XmlElement *directoryXml = indexXml->getChildElement(d);
+        IndexedDirectory *entry = new IndexedDirectory;
+        entry->path = directoryXml->getStringAttribute("path");
+        entry->modified = directoryXml->getStringAttribute("modified").getLargeIntValue();
+
+        for (int i = 0; i < directoryXml->getNumChildElements(); i++) {
+            const XmlElement *childXml = directoryXml->getChildElement(i);
+            if (childXml->hasTagName("directory")) {
+                entry->subdirectories.add(childXml->getStringAttribute("name"));
+                continue;
+            }
+
+            IndexedFile file;
+            file.name = childXml->getStringAttribute("name");
+            file.size = childXml->getStringAttribute("size").getLargeIntValue();
+            file.modified = childXml->getStringAttribute("modified").getLargeIntValue();
+            file.numChannels = childXml->getIntAttribute("channels");
+            file.sampleRate = childXml->getDoubleAttribute("sampleRate");
+            file.lengthInSamples = childXml->getStringAttribute("length").getLargeIntValue();
+            entry->files.add(file);
+        }
+
+        directoryLookup.set(entry->path, directories.size());
+        directories.add(entry);
+    }
+}
+
+void StimulusIndex::save() const {
+    XmlElement indexXml("stimulusIndex");
+    indexXml.setAttribute("version", indexVersion);
+    indexXml.setAttribute("root", root.getFullPathName());
+
+    for (int d = 0; d < directories.size(); d++) {
+        const IndexedDirectory *entry = directories[d];
+        XmlElement *directoryXml = indexXml.createNewChildElement("listing");
+        directoryXml->setAttribute("path", entry->path);
+        directoryXml->setAttribute("modified", String(entry->modified));
+
+        for (int i = 0; i < entry->subdirectories.size(); i++) {
+            directoryXml->createNewChildElement("directory")->setAttribute("name", entry->subdirectories[i]);
+        }
+
+        for (int i = 0; i < entry->files.size(); i++) {
+            const IndexedFile &file = entry->files.getReference(i);
+            XmlElement *fileXml = directoryXml->createNewChildElement("file");
+            fileXml->setAttribute("name", file.name);
+            fileXml->setAttribute("size", String(file.size));
+            fileXml->setAttribute("modified", String(file.modified));
+            if (file.numChannels > 0) {
+                fileXml->setAttribute("channels", file.numChannels);
+                fileXml->setAttribute("sampleRate", file.sampleRate);
+                fileXml->setAttribute("length", String(file.lengthInSamples));
+            }
+        }
+    }
+
+    /* the index is only a shortcut, so a failed write just means a full listing next time */
+    const File indexFile(getIndexFile());
+    indexFile.getParentDirectory().createDirectory();
+    indexXml.writeTo(indexFile);
+}
+
+File StimulusIndex::getIndexFile() const {
+    return stimulusIndexDirectory.getChildFile(String::toHexString(root.getFullPathName().hashCode64()) + ".xml");
+}
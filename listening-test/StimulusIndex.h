@@ -0,0 +1,102 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef STIMULUS_INDEX_H
+#define STIMULUS_INDEX_H
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+    The directories and files of a stimuli tree, with the sizes, modification times and, for
+    WAV files, the format of every file.  The index of each stimuli directory is kept in a file
+    on the local disk, so that a test on a network share is not listed again every time it is
+    opened: update() only lists the directories whose modification time changed since, and only
+    reads the headers of files that are new or whose size or modification time changed.
+
+    A file rewritten in place does not change the modification time of its directory, so it
+    keeps its old entry until something is added, removed or renamed next to it.  WAV files whose
+    header could not be read are the exception: they are looked at again on every update().
+*/
+class StimulusIndex {
+public:
+    struct IndexedFile {
+        String name;
+        int64 size;
+        int64 modified;             // ms since the epoch
+        int numChannels;            // 0 for files that are not WAV or could not be read
+        double sampleRate;
+        int64 lengthInSamples;
+    };
+
+    StimulusIndex();
+
+    ~StimulusIndex();
+
+    /* Brings the index of root up to date and saves it if anything changed.  Returns false if
+       root is not a directory. */
+    bool update(const File &root);
+
+    /* the directories below root, sorted by path; only its children unless recursive */
+    Array <File> getDirectories(bool recursive) const;
+
+    /* the files in directory whose names match wildcard, as File::findChildFiles() lists them */
+    Array <File> getFiles(const File &directory, const String &wildcard) const;
+
+    /* the entry of file, or nullptr if it is not in the index */
+    const IndexedFile *getFileInfo(const File &file) const;
+
+    /* Looks at file itself again and updates its entry, reading its header if it changed or could
+       not be read before, and saves the index if the entry changed.  For anything about to be
+       reported as wrong, so that it never rests on the index alone.  Returns nullptr if file is not
+       in the index. */
+    const IndexedFile *refreshFileInfo(const File &file);
+
+private:
+    struct IndexedDirectory {
+        String path;                // relative to root, empty for root itself
+        int64 modified;
+        StringArray subdirectories;
+        Array <IndexedFile> files;
+    };
+
+    /* lists directory if it changed and then its subdirectories, adding them to directories */
+    void scanDirectory(const File &directory, const String &path, bool &changed);
+
+    void readHeader(const File &file, IndexedFile &entry);
+
+    /* stats file and reads its header again if that changed or failed before; returns true if
+       entry changed */
+    bool refresh(const File &file, IndexedFile &entry);
+
+    const IndexedDirectory *findDirectory(const File &directory) const;
+
+    IndexedDirectory *findDirectory(const File &directory);
+
+    /* the index of directory in directories, or -1 */
+    int findDirectoryIndex(const File &directory) const;
+
+    void load();
+
+    void save() const;
+
+    File getIndexFile() const;
+
+    enum {
+        indexVersion = 1
+    };
+
+    File root;
+    OwnedArray <IndexedDirectory> directories;
+    HashMap <String, int> directoryLookup;      // path to index in directories
+
+    /* the index as it was read from its file while update() runs */
+    OwnedArray <IndexedDirectory> previous;
+    HashMap <String, int> previousLookup;
+
+    AudioFormatManager formatManager;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StimulusIndex);
+};
+
+#endif /* STIMULUS_INDEX_H */
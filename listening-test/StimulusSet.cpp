@@ -0,0 +1,412 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "StimulusSet.h"
+#include "Resampler.h"
+#include "TestTypes.h"
+
+/* longest stimulus that can be decoded into an AudioBuffer, whose sample count is an int */
+static const int64 maxSamplesInMemory = INT_MAX;
+
+static bool needsResampling(const AudioFormatReader &reader, double targetSampleRate) {
+    return targetSampleRate > 0.0 && roundToInt(reader.sampleRate) != roundToInt(targetSampleRate);
+}
+
+/**
+    Opens, then later loads, one stimulus file on the loader's thread pool.  The reader created
+    when the header is validated is the one used for decoding, so every file is opened once.
+*/
+class StimulusFileJob : public ThreadPoolJob {
+public:
+    enum Stage {
+        openFile,
+        loadStimulus
+    };
+
+    StimulusFileJob(const String &path, WaitableEvent &finished, std::atomic<int> &finishedCount) :
+            ThreadPoolJob("Load " + path),
+            stage(openFile),
+            file(path),
+            storage(STIMULUS_STORAGE_MEMORY),
+            channelCount(0),
+            samplesCount(0),
+            streamingThread(nullptr),
+            cache(nullptr),
+            maxPackedBytesPerSample(0),
+            loopCrossfadeSamples(0),
+            targetSampleRate(0.0),
+            loudnessCache(nullptr),
+            jobFinished(finished),
+            jobsFinished(finishedCount) {};
+
+    JobStatus runJob() override {
+        if (stage == openFile) {
+            open();
+        } else {
+            load();
+        }
+
+        ++jobsFinished;
+        jobFinished.signal();
+        return jobHasFinished;
+    }
+
+    Stage stage;
+    const File file;
+
+    /* set before the load stage */
+    stimulusStorageEnum storage;
+    int channelCount;
+    int64 samplesCount;
+    TimeSliceThread *streamingThread;
+    StimulusCache *cache;
+    int maxPackedBytesPerSample;
+    int loopCrossfadeSamples;
+    double targetSampleRate;
+    LoudnessCache *loudnessCache;   // nullptr when loudness is not measured
+
+    std::unique_ptr <AudioFormatReader> reader;
+    std::unique_ptr <StimulusSource> stimulus;
+    LoudnessInfo loudness;
+    String error;
+    String logMessage;
+
+private:
+    void open() {
+        /* Create input stream for the audio file */
+        FileInputStream *af = new FileInputStream(file);
+        if (af->failedToOpen()) {
+            delete af;
+            error = String::formatted("Could not open file %s.", file.getFullPathName().toWideCharPointer());
+            return;
+        }
+
+        WavAudioFormat waf;
+        reader.reset(waf.createReaderFor(af, true));
+        if (reader == nullptr) {
+            error = "Unable to create reader for  " + file.getFullPathName();
+        }
+    }
+
+    void load() {
+        if (loudnessCache != nullptr) {
+            measureLoudness();
+        }
+
+        if (needsResampling(*reader, targetSampleRate)) {
+            loadResampled();
+            return;
+        }
+
+        if (storage == STIMULUS_STORAGE_MAPPED) {
+            stimulus.reset(MappedStimulus::createFor(file, channelCount, samplesCount));
+            if (stimulus != nullptr) {
+                logMessage = "Mapped file " + file.getFullPathName();
+                return;
+            }
+            if (samplesCount > maxSamplesInMemory) {
+                error = "Cannot map " + file.getFullPathName() + ", and it is too long to be loaded into memory";
+                return;
+            }
+            logMessage = "Cannot map " + file.getFullPathName() + ", loading it into memory instead";
+        }
+
+        if (storage == STIMULUS_STORAGE_STREAM) {
+            logMessage = "Streaming file " + file.getFullPathName();
+            stimulus.reset(new StreamingStimulus(reader.release(), channelCount, samplesCount, loopCrossfadeSamples,
+                                                 *streamingThread));
+        } else {
+            loadIntoMemory();
+        }
+    }
+
+    void loadIntoMemory() {
+        jassert(samplesCount <= maxSamplesInMemory);
+        const int numSamples = (int) samplesCount;
+        bool reused = true;
+        const int packedBytes = PackedStimulus::getPackedBytesPerSample(*reader, maxPackedBytesPerSample);
+
+        if (packedBytes > 0) {
+            SharedPackedAudio audio(cache->findPacked(file, channelCount, numSamples, packedBytes));
+            if (audio == nullptr) {
+                audio = PackedStimulus::decode(reader.get(), channelCount, numSamples, packedBytes);
+                cache->add(file, audio);
+                reused = false;
+            }
+            stimulus.reset(new PackedStimulus(audio));
+        } else {
+            SharedAudioBuffer audio(cache->find(file, channelCount, numSamples));
+            if (audio == nullptr) {
+                audio = BufferedStimulus::decode(reader.get(), channelCount, numSamples);
+                cache->add(file, audio);
+                reused = false;
+            }
+            stimulus.reset(new BufferedStimulus(audio));
+        }
+
+        if (logMessage.isEmpty()) {
+            logMessage = (reused ? "Reusing decoded file " : "Loading file ") + file.getFullPathName();
+        }
+    }
+
+    void measureLoudness() {
+        const String fingerprint(LoudnessCache::getFingerprint(file));
+        if (fingerprint.isNotEmpty() && loudnessCache->find(fingerprint, loudness))
+            return;
+
+        const bool measured = LoudnessMeter::measure(*reader, channelCount, reader->lengthInSamples, loudness,
+                                                     [this] { return shouldExit(); });
+        if (measured && fingerprint.isNotEmpty()) {
+            loudnessCache->add(fingerprint, loudness);
+        }
+    }
+
+    void loadResampled() {
+        if (storage != STIMULUS_STORAGE_MEMORY) {
+            logMessage = file.getFullPathName() + " has to be resampled, so it is loaded into memory. ";
+        }
+
+        jassert(samplesCount <= maxSamplesInMemory && reader->lengthInSamples <= maxSamplesInMemory);
+        SharedAudioBuffer audio(cache->find(file, channelCount, (int) samplesCount, targetSampleRate));
+        if (audio != nullptr) {
+            logMessage << "Reusing file " << file.getFullPathName() << " resampled to " << targetSampleRate << " Hz";
+        } else {
+            /* the file at its own rate is cached too, so another device rate only costs the resampling */
+            const int sourceSamples = (int) reader->lengthInSamples;
+            SharedAudioBuffer original(cache->find(file, channelCount, sourceSamples));
+            if (original == nullptr) {
+                original = BufferedStimulus::decode(reader.get(), channelCount, sourceSamples);
+                cache->add(file, original);
+            }
+
+            const Resampler resampler(reader->sampleRate, targetSampleRate);
+            audio = resampler.process(*original, channelCount, (int) samplesCount);
+            cache->add(file, audio, targetSampleRate);
+            logMessage << "Resampled file " << file.getFullPathName() << " from " << reader->sampleRate
+                       << " Hz to " << targetSampleRate << " Hz";
+        }
+
+        stimulus.reset(new BufferedStimulus(audio));
+    }
+
+    WaitableEvent &jobFinished;
+    std::atomic<int> &jobsFinished;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StimulusFileJob);
+};
+
+//==============================================================================
+StimulusLoader::StimulusLoader(const PlaybackSettings &settings, TimeSliceThread &t, StimulusCache &c,
+                               Logger &log) :
+        playbackSettings(settings),
+        streamingThread(t),
+        cache(c),
+        logger(log),
+        pool(jmax(1, SystemStats::getNumCpus())),
+        loudnessCache(loudnessCacheFile),
+        targetSampleRate(0.0) {
+}
+
+StimulusLoader::~StimulusLoader() {
+    pool.removeAllJobs(true, 10000);
+}
+
+bool StimulusLoader::runJobs(OwnedArray <StimulusFileJob> &jobs, std::atomic<int> &jobsFinished,
+                             WaitableEvent &jobFinished, Thread &thread,
+                             const std::function<void(double)> &progress) {
+    jobsFinished = 0;
+    for (int i = 0; i < jobs.size(); i++) {
+        pool.addJob(jobs[i], false);
+    }
+
+    while (jobsFinished < jobs.size()) {
+        if (thread.threadShouldExit()) {
+            /* wait for the files already being read, drop the rest */
+            for (int i = 0; i < jobs.size(); i++) {
+                pool.removeJob(jobs[i], true, -1);
+            }
+            return false;
+        }
+
+        jobFinished.wait(20);
+        if (progress) {
+            progress((double) jobsFinished / jobs.size());
+        }
+    }
+
+    /* make sure the pool has let go of the jobs before they are reused or deleted */
+    for (int i = 0; i < jobs.size(); i++) {
+        pool.waitForJobToFinish(jobs[i], -1);
+    }
+    return true;
+}
+
+String StimulusLoader::load(const Trial &trial, Thread &thread, const std::function<void(double)> &progress,
+                            StimulusSet &dest) {
+    cache.setMemoryBudget((int64) playbackSettings.stimulusCacheMB * 1024 * 1024);
+    const double sampleRate = targetSampleRate;
+
+    WaitableEvent jobFinished;
+    std::atomic<int> jobsFinished(0);
+    OwnedArray <StimulusFileJob> jobs;
+
+    for (int i = 0; i < trial.soundFiles.size(); i++) {
+        jobs.add(new StimulusFileJob(trial.soundFiles[i], jobFinished, jobsFinished));
+    }
+
+    // Open all files and validate channel count consistency
+    // Use the sample count of the first file for all
+    if (!runJobs(jobs, jobsFinished, jobFinished, thread, nullptr))
+        return "Loading was cancelled";
+
+    Array <int64> samplesCountPerFile;
+    for (int i = 0; i < jobs.size(); i++) {
+        if (jobs[i]->error.isNotEmpty())
+            return jobs[i]->error;
+
+        const AudioFormatReader &wavReader = *jobs[i]->reader;
+        if (needsResampling(wavReader, sampleRate)) {
+            samplesCountPerFile.add(Resampler::getResampledLength(wavReader.lengthInSamples, wavReader.sampleRate,
+                                                                  sampleRate));
+        } else {
+            samplesCountPerFile.add(wavReader.lengthInSamples);
+        }
+
+        if (i == 0) {
+            dest.channelCount = wavReader.numChannels;
+            dest.sampleRate = sampleRate > 0.0 ? sampleRate : wavReader.sampleRate;
+        } else if ((int) wavReader.numChannels != dest.channelCount) {
+            return String::formatted("The number of audio channels in %s is %i; expected %i",
+                                     trial.soundFiles[i].toWideCharPointer(),
+                                     (int) wavReader.numChannels,
+                                     dest.channelCount);
+        }
+    }
+
+    /* streamed and mapped stimuli can be of any length, decoded ones have to fit an AudioBuffer */
+    dest.samplesCount = samplesCountPerFile[0];
+    for (int i = 0; i < jobs.size(); i++) {
+        const bool inMemory = playbackSettings.stimulusStorage == STIMULUS_STORAGE_MEMORY
+                              || needsResampling(*jobs[i]->reader, sampleRate);
+        if (inMemory && jmax(samplesCountPerFile[i], jobs[i]->reader->lengthInSamples) > maxSamplesInMemory) {
+            return "Sorry, I cannot load " + trial.soundFiles[i] + " into memory because it has more than "
+                   + String(maxSamplesInMemory) + " samples per channel; stream or map it instead";
+        }
+    }
+
+    if (playbackSettings.stimulusStorage == STIMULUS_STORAGE_STREAM && !streamingThread.isThreadRunning()) {
+        streamingThread.startThread();
+    }
+
+    // Load all stimuli at once
+    for (int i = 0; i < jobs.size(); i++) {
+        jobs[i]->stage = StimulusFileJob::loadStimulus;
+        jobs[i]->storage = playbackSettings.stimulusStorage;
+        jobs[i]->channelCount = dest.channelCount;
+        jobs[i]->samplesCount = dest.samplesCount;
+        jobs[i]->streamingThread = &streamingThread;
+        jobs[i]->cache = &cache;
+        jobs[i]->maxPackedBytesPerSample = playbackSettings.getMaxPackedBytesPerSample();
+        jobs[i]->loopCrossfadeSamples = playbackSettings.loopCrossfadeSamples;
+        jobs[i]->targetSampleRate = sampleRate;
+        jobs[i]->loudnessCache = playbackSettings.loudness != LOUDNESS_OFF ? &loudnessCache : nullptr;
+    }
+
+    if (!runJobs(jobs, jobsFinished, jobFinished, thread, progress))
+        return "Loading was cancelled";
+
+    for (int i = 0; i < jobs.size(); i++) {
+        if (jobs[i]->error.isNotEmpty())
+            return jobs[i]->error;
+    }
+
+    for (int i = 0; i < jobs.size(); i++) {
+        logger.logMessage(jobs[i]->logMessage);
+        dest.stimuli.add(jobs[i]->stimulus.release());
+        dest.loudness.add(jobs[i]->loudness);
+        dest.gains.add(getLevelGain(jobs[i]->loudness));
+
+        if (playbackSettings.loudness != LOUDNESS_OFF) {
+            logger.logMessage(String::formatted("    %.1f LUFS, %.1f dBTP, playing at %+.1f dB",
+                                                jobs[i]->loudness.integratedLufs, jobs[i]->loudness.truePeakDbtp,
+                                                Decibels::gainToDecibels(dest.gains.getLast())));
+        }
+    }
+
+    if (playbackSettings.loudness != LOUDNESS_OFF) {
+        loudnessCache.save();
+    }
+
+    progress(1.0);
+    return String();
+}
+
+float StimulusLoader::getLevelGain(const LoudnessInfo &info) const {
+    if (playbackSettings.loudness != LOUDNESS_MATCH || !std::isfinite(info.integratedLufs))
+        return 1.0f;
+
+    double gainDb = playbackSettings.targetLoudness - info.integratedLufs;
+    if (std::isfinite(info.truePeakDbtp)) {
+        gainDb = jmin(gainDb, playbackSettings.truePeakCeiling - info.truePeakDbtp);
+    }
+    return Decibels::decibelsToGain((float) gainDb);
+}
+
+//==============================================================================
+StimulusPrefetcher::StimulusPrefetcher(StimulusLoader &l, Logger &log) :
+        Thread("Stimulus prefetch"),
+        loader(l),
+        logger(log),
+        trial(nullptr),
+        trialIndex(-1),
+        progress(0.0) {
+}
+
+StimulusPrefetcher::~StimulusPrefetcher() {
+    cancel();
+}
+
+void StimulusPrefetcher::prefetch(const Trial &newTrial, int newTrialIndex) {
+    cancel();
+
+    trial = &newTrial;
+    trialIndex = newTrialIndex;
+    progress = 0.0;
+    startThread();
+}
+
+void StimulusPrefetcher::cancel() {
+    stopThread(10000);
+    trial = nullptr;
+    trialIndex = -1;
+    loadedSet.reset();
+    error = String();
+}
+
+std::unique_ptr <StimulusSet> StimulusPrefetcher::take(int wantedTrialIndex) {
+    waitForThreadToExit(-1);
+
+    std::unique_ptr <StimulusSet> set;
+    if (wantedTrialIndex == trialIndex && error.isEmpty()) {
+        set = std::move(loadedSet);
+    } else if (error.isNotEmpty()) {
+        logger.logMessage("Prefetch of trial " + String(trialIndex) + " failed: " + error);
+    }
+
+    trial = nullptr;
+    trialIndex = -1;
+    loadedSet.reset();
+    error = String();
+    return set;
+}
+
+void StimulusPrefetcher::run() {
+    std::unique_ptr <StimulusSet> set(new StimulusSet);
+    set->trialIndex = trialIndex;
+
+    error = loader.load(*trial, *this, [this](double p) { progress = p; }, *set);
+    if (error.isEmpty()) {
+        loadedSet = std::move(set);
+    }
+}
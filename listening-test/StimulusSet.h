@@ -0,0 +1,122 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef STIMULUS_SET_H
+#define STIMULUS_SET_H
+
+#include <JuceHeader.h>
+#include "StimulusSource.h"
+#include "StimulusCache.h"
+#include "PlaybackSettings.h"
+#include "Loudness.h"
+#include "Trial.h"
+#include <atomic>
+#include <functional>
+
+/**
+    The audio of every stimulus of one trial, ready to be handed to the AudioPlayer.
+*/
+class StimulusSet {
+public:
+    StimulusSet() : trialIndex(-1), channelCount(0), samplesCount(0), sampleRate(0.0) {};
+
+    int trialIndex;
+    int channelCount;
+    int64 samplesCount;
+    double sampleRate;      // the rate the stimuli play at
+    OwnedArray <StimulusSource> stimuli;
+    Array <LoudnessInfo> loudness;  // measured, or silence when loudness measuring is off
+    Array<float> gains;             // applied while playing, for level matching
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StimulusSet);
+};
+
+class StimulusFileJob;
+
+/**
+    Opens and loads all stimuli of a trial as the playback settings ask.  The files are
+    opened and then decoded in parallel on a pool with one thread per core; decoded audio
+    is taken from and added to the stimulus cache.  Files recorded at another rate than the
+    target sample rate are resampled to it and kept in memory.  Unless the settings turn it
+    off, the loudness of every file is measured too, or taken from the loudness cache.
+*/
+class StimulusLoader {
+public:
+    StimulusLoader(const PlaybackSettings &settings, TimeSliceThread &streamingThread, StimulusCache &cache,
+                   Logger &log);
+
+    ~StimulusLoader();
+
+    /* Rate the stimuli loaded from now on should play at, normally the device's; 0 plays every
+       file at its own rate */
+    void setTargetSampleRate(double sampleRate) { targetSampleRate = sampleRate; }
+
+    double getTargetSampleRate() const { return targetSampleRate; }
+
+    /* Returns an empty string on success or the error message.  progress is called as files
+       complete; loading stops early when thread.threadShouldExit() becomes true. */
+    String load(const Trial &trial, Thread &thread, const std::function<void(double)> &progress, StimulusSet &dest);
+
+private:
+    /* gain that brings a stimulus to the target loudness, if the settings ask for level matching */
+    float getLevelGain(const LoudnessInfo &info) const;
+
+    bool runJobs(OwnedArray <StimulusFileJob> &jobs, std::atomic<int> &jobsFinished, WaitableEvent &jobFinished,
+                 Thread &thread, const std::function<void(double)> &progress);
+
+    const PlaybackSettings &playbackSettings;
+    TimeSliceThread &streamingThread;
+    StimulusCache &cache;
+    Logger &logger;
+    ThreadPool pool;
+    LoudnessCache loudnessCache;
+    std::atomic<double> targetSampleRate;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StimulusLoader);
+};
+
+
+/**
+    Loads the stimuli of the trial after the current one in the background, so that
+    moving on to it is a swap instead of a decode.
+*/
+class StimulusPrefetcher : public Thread {
+public:
+    StimulusPrefetcher(StimulusLoader &loader, Logger &log);
+
+    ~StimulusPrefetcher();
+
+    /* Starts loading a trial, dropping any earlier prefetch */
+    void prefetch(const Trial &trial, int trialIndex);
+
+    /* Stops the loader and drops whatever it loaded */
+    void cancel();
+
+    /* Index of the trial being or already prefetched, or -1 */
+    int getTrialIndex() const { return trialIndex; }
+
+    bool isReady() const { return trialIndex >= 0 && !isThreadRunning(); }
+
+    double getProgress() const { return progress; }
+
+    /* Waits for the loader, then hands over the loaded set if it belongs to trialIndex and
+       loaded without errors; returns nullptr otherwise. */
+    std::unique_ptr <StimulusSet> take(int trialIndex);
+
+    void run() override;
+
+private:
+    StimulusLoader &loader;
+    Logger &logger;
+
+    const Trial *trial;
+    int trialIndex;
+    std::unique_ptr <StimulusSet> loadedSet;
+    String error;
+    std::atomic<double> progress;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StimulusPrefetcher);
+};
+
+#endif /* STIMULUS_SET_H */
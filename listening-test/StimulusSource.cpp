@@ -0,0 +1,375 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#include "StimulusSource.h"
+
+const int streamingRingSamples = 1 << 16;        // read-ahead per stimulus, ~1.4 s at 48 kHz
+const int streamingLoopHeadSamples = 1 << 15;    // start of the loop kept for seamless wrap-around
+const int streamingReadChunkSamples = 8192;      // largest read done in one time slice
+
+/* the ring window is packed as 40 bits of start position and 24 bits of length */
+const int windowLengthBits = 24;
+
+static uint64 packWindow(int64 start, int length) {
+    return ((uint64) start << windowLengthBits) | (uint64) length;
+}
+
+static int64 getWindowStart(uint64 w) { return (int64) (w >> windowLengthBits); }
+
+static int getWindowLength(uint64 w) { return (int) (w & ((1 << windowLengthBits) - 1)); }
+
+//==============================================================================
+BufferedStimulus::BufferedStimulus(SharedAudioBuffer audio) :
+        buffer(std::move(audio)) {
+}
+
+SharedAudioBuffer BufferedStimulus::decode(AudioFormatReader *reader, int numChannels, int numSamples) {
+    std::shared_ptr <AudioBuffer<float>> audio(new AudioBuffer<float>(numChannels, numSamples));
+    reader->read(audio.get(), 0, numSamples, 0, false, false);
+    return audio;
+}
+
+void BufferedStimulus::read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) {
+    for (int ch = 0; ch < buffer->getNumChannels(); ch++) {
+        dest.copyFrom(ch, destStartSample, *buffer, ch, (int) sourceSample, numSamples);
+    }
+}
+
+//==============================================================================
+StreamingStimulus::StreamingStimulus(AudioFormatReader *r, int numChannels, int64 lengthInSamples,
+                                     int loopPrerollSamples, TimeSliceThread &t) :
+        reader(r),
+        thread(t),
+        channelCount(numChannels),
+        totalSamples(lengthInSamples),
+        loopPreroll(jmax(0, loopPrerollSamples)),
+        ring(numChannels, streamingRingSamples),
+        window(packWindow(0, 0)),
+        activeLoopHead(0),
+        playheadSample(0),
+        loopStartSample(0),
+        generation(0) {
+    ring.clear();
+    for (int i = 0; i < 2; i++) {
+        loopHeads[i].setSize(numChannels, loopPreroll + streamingLoopHeadSamples);
+        loopHeads[i].clear();
+        loopHeadStart[i] = -1;
+        loopHeadLength[i] = 0;
+    }
+
+    /* prime the buffers before the audio thread can see this stimulus */
+    fillLoopHead();
+    while (fillRing()) {}
+
+    thread.addTimeSliceClient(this);
+}
+
+StreamingStimulus::~StreamingStimulus() {
+    thread.removeTimeSliceClient(this);
+}
+
+void StreamingStimulus::setPlayhead(int64 nextSample, int64 loopStart) {
+    playheadSample.store(nextSample, std::memory_order_release);
+    loopStartSample.store(loopStart, std::memory_order_release);
+}
+
+void StreamingStimulus::read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) {
+    if (numSamples <= 0)
+        return;
+
+    const uint32 generationBefore = generation.load(std::memory_order_acquire);
+    bool ok = readFromRing(dest, destStartSample, sourceSample, numSamples) ||
+              readFromLoopHead(dest, destStartSample, sourceSample, numSamples);
+
+    if (ok) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        ok = generation.load(std::memory_order_relaxed) == generationBefore;
+    }
+
+    if (!ok) {
+        /* not buffered yet (or recycled while copying): play silence rather than wait for the disk */
+        for (int ch = 0; ch < channelCount; ch++) {
+            dest.clear(ch, destStartSample, numSamples);
+        }
+    }
+}
+
+bool StreamingStimulus::readFromRing(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample,
+                                     int numSamples) {
+    /* after a jump backwards the reader may still be recycling that part of the ring */
+    if (sourceSample < playheadSample.load(std::memory_order_relaxed))
+        return false;
+
+    const uint64 w = window.load(std::memory_order_acquire);
+    const int64 start = getWindowStart(w);
+    if (sourceSample < start || sourceSample + numSamples > start + getWindowLength(w))
+        return false;
+
+    const int ringPos = (int) (sourceSample % streamingRingSamples);
+    const int firstPart = jmin(numSamples, streamingRingSamples - ringPos);
+    for (int ch = 0; ch < channelCount; ch++) {
+        dest.copyFrom(ch, destStartSample, ring, ch, ringPos, firstPart);
+        if (numSamples > firstPart) {
+            dest.copyFrom(ch, destStartSample + firstPart, ring, ch, 0, numSamples - firstPart);
+        }
+    }
+    return true;
+}
+
+bool StreamingStimulus::readFromLoopHead(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample,
+                                         int numSamples) {
+    const int active = activeLoopHead.load(std::memory_order_acquire);
+    const int64 start = loopHeadStart[active];
+    if (start < 0 || sourceSample < start || sourceSample + numSamples > start + loopHeadLength[active])
+        return false;
+
+    const int offset = (int) (sourceSample - start);
+    for (int ch = 0; ch < channelCount; ch++) {
+        dest.copyFrom(ch, destStartSample, loopHeads[active], ch, offset, numSamples);
+    }
+    return true;
+}
+
+//==============================================================================
+int StreamingStimulus::useTimeSlice() {
+    const bool loopHeadChanged = fillLoopHead();
+    const bool ringNeedsMore = fillRing();
+    return (loopHeadChanged || ringNeedsMore) ? 0 : 5;
+}
+
+bool StreamingStimulus::fillRing() {
+    const int64 playhead = playheadSample.load(std::memory_order_acquire);
+    const uint64 w = window.load(std::memory_order_relaxed);
+    int64 start = getWindowStart(w);
+    int64 end = start + getWindowLength(w);
+
+    if (playhead < start || playhead > end) {
+        /* the playhead left the buffered window: start again from there */
+        ++generation;
+        start = end = playhead;
+        window.store(packWindow(start, 0), std::memory_order_release);
+    } else if (playhead > start) {
+        /* release what has been played */
+        start = playhead;
+        window.store(packWindow(start, (int) (end - start)), std::memory_order_release);
+    }
+
+    const int64 wantedEnd = jmin(totalSamples, start + streamingRingSamples);
+    const int numToRead = (int) jmin((int64) streamingReadChunkSamples, wantedEnd - end);
+    if (numToRead <= 0)
+        return false;
+
+    const int ringPos = (int) (end % streamingRingSamples);
+    const int firstPart = jmin(numToRead, streamingRingSamples - ringPos);
+    reader->read(&ring, ringPos, firstPart, end, false, false);
+    if (numToRead > firstPart) {
+        reader->read(&ring, 0, numToRead - firstPart, end + firstPart, false, false);
+    }
+
+    end += numToRead;
+    window.store(packWindow(start, (int) (end - start)), std::memory_order_release);
+    return end < wantedEnd;
+}
+
+bool StreamingStimulus::fillLoopHead() {
+    /* the crossfade at the loop end reads the samples before the loop start, behind the playhead */
+    const int64 loopStart = loopStartSample.load(std::memory_order_acquire);
+    const int64 headStart = jmax((int64) 0, loopStart - loopPreroll);
+    const int active = activeLoopHead.load(std::memory_order_relaxed);
+    if (loopHeadStart[active] == headStart)
+        return false;
+
+    /* refill the buffer that is not being played and swap */
+    const int spare = 1 - active;
+    ++generation;
+    loopHeadStart[spare] = headStart;
+    loopHeadLength[spare] = (int) jlimit((int64) 0, (int64) loopHeads[spare].getNumSamples(), totalSamples - headStart);
+    reader->read(&loopHeads[spare], 0, loopHeadLength[spare], headStart, false, false);
+    activeLoopHead.store(spare, std::memory_order_release);
+    return true;
+}
+
+//==============================================================================
+const int interleavedScratchFrames = 1024;
+const int packedDecodeChunkSamples = 8192;
+
+/* Finds the sample data of a RIFF or RF64 WAV file */
+static bool findWavDataChunk(const File &file, int64 &dataStart, int64 &dataLength) {
+    FileInputStream in(file);
+    if (in.failedToOpen())
+        return false;
+
+    const uint32 riffType = (uint32) in.readInt();
+    const bool isRF64 = (riffType == ByteOrder::littleEndianInt("RF64"));
+    if (riffType != ByteOrder::littleEndianInt("RIFF") && !isRF64)
+        return false;
+
+    in.readInt(); // RIFF size
+    if ((uint32) in.readInt() != ByteOrder::littleEndianInt("WAVE"))
+        return false;
+
+    int64 rf64DataLength = -1;
+    while (!in.isExhausted()) {
+        const uint32 chunkType = (uint32) in.readInt();
+        const int64 chunkLength = (int64) (uint32) in.readInt();
+        const int64 chunkEnd = in.getPosition() + chunkLength + (chunkLength & 1);
+
+        if (chunkType == ByteOrder::littleEndianInt("ds64")) {
+            in.readInt64(); // RIFF size
+            rf64DataLength = in.readInt64();
+        } else if (chunkType == ByteOrder::littleEndianInt("data")) {
+            dataStart = in.getPosition();
+            dataLength = (isRF64 && rf64DataLength >= 0) ? rf64DataLength : chunkLength;
+            dataLength = jmin(dataLength, in.getTotalLength() - dataStart);
+            return true;
+        }
+
+        if (!in.setPosition(chunkEnd))
+            return false;
+    }
+    return false;
+}
+
+MappedStimulus *MappedStimulus::createFor(const File &file, int numChannels, int64 numSamples) {
+    /* let JUCE's reader validate the format */
+    WavAudioFormat waf;
+    std::unique_ptr <MemoryMappedAudioFormatReader> wavReader(waf.createMemoryMappedReader(file));
+    if (wavReader == nullptr || (int) wavReader->numChannels != numChannels || wavReader->lengthInSamples < numSamples)
+        return nullptr;
+
+    SampleConverter converter = nullptr;
+    if (wavReader->usesFloatingPointData) {
+        if (wavReader->bitsPerSample == 32) converter = convertFloat32ToFloat;
+    } else if (wavReader->bitsPerSample == 16) {
+        converter = convertInt16ToFloat;
+    } else if (wavReader->bitsPerSample == 24) {
+        converter = convertInt24ToFloat;
+    }
+    if (converter == nullptr)
+        return nullptr;
+
+    const int bytesPerSample = (int) wavReader->bitsPerSample / 8;
+    const int64 bytesNeeded = numSamples * numChannels * bytesPerSample;
+
+    /* JUCE's reader does not expose its mapping, so map the data chunk ourselves */
+    int64 dataStart = 0, dataLength = 0;
+    if (!findWavDataChunk(file, dataStart, dataLength) || dataLength < bytesNeeded)
+        return nullptr;
+
+    MemoryMappedFile *map = new MemoryMappedFile(file, Range<int64>(dataStart, dataStart + bytesNeeded),
+                                                 MemoryMappedFile::readOnly);
+    if (map->getData() == nullptr || map->getRange().getEnd() < dataStart + bytesNeeded) {
+        delete map;
+        return nullptr;
+    }
+
+    /* the mapping starts on a page boundary */
+    const char *sampleData = static_cast<const char *> (map->getData()) + (dataStart - map->getRange().getStart());
+
+    /* prefault the pages now rather than in the audio callback */
+    const int pageSize = 4096;
+    volatile char sink = 0;
+    for (int64 i = 0; i < bytesNeeded; i += pageSize) {
+        sink = sink + sampleData[i];
+    }
+
+    return new MappedStimulus(map, sampleData, numChannels, bytesPerSample, converter);
+}
+
+MappedStimulus::MappedStimulus(MemoryMappedFile *m, const char *data, int numChannels, int bytesPerSample,
+                               SampleConverter c) :
+        InterleavedStimulus(data, numChannels, bytesPerSample, c),
+        map(m) {
+}
+
+//==============================================================================
+PackedAudio::PackedAudio(int chans, int samps, int bytes) :
+        data((size_t) chans * (size_t) samps * (size_t) bytes),
+        numChannels(chans),
+        numSamples(samps),
+        bytesPerSample(bytes) {
+}
+
+PackedStimulus::PackedStimulus(SharedPackedAudio a) :
+        InterleavedStimulus(a->data.get(), a->numChannels, a->bytesPerSample,
+                            a->bytesPerSample == 2 ? convertInt16ToFloat : convertInt24ToFloat),
+        audio(std::move(a)) {
+}
+
+int PackedStimulus::getPackedBytesPerSample(const AudioFormatReader &reader, int maxBytesPerSample) {
+    if (reader.usesFloatingPointData)
+        return 0;
+    if (reader.bitsPerSample == 16 && maxBytesPerSample >= 2)
+        return 2;
+    if (reader.bitsPerSample == 24 && maxBytesPerSample >= 3)
+        return 3;
+    return 0;
+}
+
+SharedPackedAudio PackedStimulus::decode(AudioFormatReader *reader, int numChannels, int numSamples,
+                                         int bytesPerSample) {
+    jassert(bytesPerSample == 2 || bytesPerSample == 3);
+    std::shared_ptr <PackedAudio> packed(new PackedAudio(numChannels, numSamples, bytesPerSample));
+
+    /* integer readers return left-justified 32 bit samples, so shifting back down is lossless */
+    HeapBlock<int> chunk((size_t) (packedDecodeChunkSamples * numChannels));
+    HeapBlock<int *> chunkChannels((size_t) numChannels);
+    for (int ch = 0; ch < numChannels; ch++) {
+        chunkChannels[ch] = chunk.get() + ch * packedDecodeChunkSamples;
+    }
+
+    uint8 *dest = reinterpret_cast<uint8 *> (packed->data.get());
+    for (int pos = 0; pos < numSamples; pos += packedDecodeChunkSamples) {
+        const int num = jmin(packedDecodeChunkSamples, numSamples - pos);
+        reader->read(chunkChannels.get(), numChannels, pos, num, false);
+
+        for (int i = 0; i < num; i++) {
+            for (int ch = 0; ch < numChannels; ch++) {
+                const uint32 v = (uint32) chunkChannels[ch][i];
+                if (bytesPerSample == 2) {
+                    *dest++ = (uint8) (v >> 16);
+                    *dest++ = (uint8) (v >> 24);
+                } else {
+                    *dest++ = (uint8) (v >> 8);
+                    *dest++ = (uint8) (v >> 16);
+                    *dest++ = (uint8) (v >> 24);
+                }
+            }
+        }
+    }
+    return packed;
+}
+
+//==============================================================================
+InterleavedStimulus::InterleavedStimulus(const char *data, int numChannels, int bytesPerSample,
+                                         SampleConverter c) :
+        sampleData(data),
+        channelCount(numChannels),
+        bytesPerFrame(numChannels * bytesPerSample),
+        converter(c),
+        scratch((size_t) (interleavedScratchFrames * numChannels)),
+        destChannels((size_t) numChannels) {
+}
+
+void InterleavedStimulus::read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) {
+    const char *src = sampleData + sourceSample * bytesPerFrame;
+
+    while (numSamples > 0) {
+        const int num = jmin(numSamples, interleavedScratchFrames);
+
+        if (channelCount == 1) {
+            converter(src, dest.getWritePointer(0, destStartSample), num);
+        } else {
+            converter(src, scratch.get(), num * channelCount);
+            for (int ch = 0; ch < channelCount; ch++) {
+                destChannels[ch] = dest.getWritePointer(ch, destStartSample);
+            }
+            deinterleaveSamples(scratch.get(), destChannels.get(), channelCount, num);
+        }
+
+        src += (int64) num * bytesPerFrame;
+        destStartSample += num;
+        numSamples -= num;
+    }
+}
@@ -0,0 +1,201 @@
+//
+//    Listening Test Application
+//    Copyright(C) 2017  Netflix, Inc.
+
+#ifndef STIMULUS_SOURCE_H
+#define STIMULUS_SOURCE_H
+
+#include <JuceHeader.h>
+#include "SampleKernels.h"
+#include <atomic>
+#include <memory>
+
+typedef std::shared_ptr<const AudioBuffer<float>> SharedAudioBuffer;
+
+/**
+    Audio data of one stimulus as seen by the audio callback.
+*/
+class StimulusSource {
+public:
+    virtual ~StimulusSource() {};
+
+    /* Copies numSamples samples of every channel, starting at sourceSample, into dest at destStartSample.
+       Called on the audio thread, so implementations must not block or allocate. */
+    virtual void read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) = 0;
+
+    /* Called on the audio thread once per block for every stimulus of the trial, so that sources
+       reading ahead from disk can follow the playhead and the loop region. */
+    virtual void setPlayhead(int64 nextSample, int64 loopStartSample) { ignoreUnused(nextSample, loopStartSample); }
+};
+
+
+/**
+    Stimulus fully decoded into memory.  The decoded audio may be shared with other trials.
+*/
+class BufferedStimulus : public StimulusSource {
+public:
+    explicit BufferedStimulus(SharedAudioBuffer audio);
+
+    static SharedAudioBuffer decode(AudioFormatReader *reader, int numChannels, int numSamples);
+
+    const SharedAudioBuffer &getAudio() const { return buffer; }
+
+    void read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) override;
+
+private:
+    SharedAudioBuffer buffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BufferedStimulus);
+};
+
+
+/**
+    Stimulus streamed from disk.  A background TimeSliceThread keeps a ring buffer filled
+    with the samples ahead of the playhead, and a second buffer holding the start of the loop
+    so that wrapping around the loop does not have to wait for the disk.  That buffer also
+    holds the samples the loop crossfade reads from just before the loop start.  The audio thread
+    only ever copies from memory that has already been filled; anything else is played as
+    silence while the reader catches up.
+*/
+class StreamingStimulus : public StimulusSource,
+                          private TimeSliceClient {
+public:
+    /* Takes ownership of the reader.  loopPrerollSamples is the length of the loop crossfade, which
+       reads that far before the loop start. */
+    StreamingStimulus(AudioFormatReader *reader, int numChannels, int64 lengthInSamples, int loopPrerollSamples,
+                      TimeSliceThread &thread);
+
+    ~StreamingStimulus();
+
+    void read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) override;
+
+    void setPlayhead(int64 nextSample, int64 loopStartSample) override;
+
+private:
+    int useTimeSlice() override;
+
+    bool fillRing();
+
+    bool fillLoopHead();
+
+    bool readFromRing(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples);
+
+    bool readFromLoopHead(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples);
+
+    std::unique_ptr <AudioFormatReader> reader;
+    TimeSliceThread &thread;
+    const int channelCount;
+    const int64 totalSamples;
+    const int loopPreroll;
+
+    /* Read-ahead ring; the sample at file position p lives at index p % ringSize.  The window of valid
+       positions is packed into one atomic so the audio thread always sees a consistent start and length. */
+    AudioBuffer<float> ring;
+    std::atomic <uint64> window;
+
+    /* Start of the loop from loopPreroll samples before it, double-buffered so the reader can
+       refill one while the other is played */
+    AudioBuffer<float> loopHeads[2];
+    int64 loopHeadStart[2];
+    int loopHeadLength[2];
+    std::atomic<int> activeLoopHead;
+
+    /* Written by the audio thread */
+    std::atomic <int64> playheadSample;
+    std::atomic <int64> loopStartSample;
+
+    /* Bumped by the reader thread before it overwrites memory the audio thread may still be copying */
+    std::atomic <uint32> generation;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StreamingStimulus);
+};
+
+/**
+    Stimulus kept as interleaved 16 bit, 24 bit or 32 bit float samples and converted to float
+    inside the audio callback with the SampleKernels.
+*/
+class InterleavedStimulus : public StimulusSource {
+public:
+    void read(AudioBuffer<float> &dest, int destStartSample, int64 sourceSample, int numSamples) override;
+
+protected:
+    InterleavedStimulus(const char *sampleData, int numChannels, int bytesPerSample, SampleConverter converter);
+
+private:
+    const char *sampleData;
+    const int channelCount;
+    const int bytesPerFrame;
+    const SampleConverter converter;
+
+    /* interleaved float scratch for multichannel data, allocated up front */
+    HeapBlock<float> scratch;
+    HeapBlock<float *> destChannels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InterleavedStimulus);
+};
+
+
+/**
+    PCM WAV stimulus played straight from a memory-mapped file, so loading a trial only
+    costs mapping and prefaulting the file, and the page cache is shared with other trials
+    and processes.
+*/
+class MappedStimulus : public InterleavedStimulus {
+public:
+    /* Returns nullptr if the file is not a 16 bit, 24 bit or 32 bit float PCM WAV file with the
+       given channel count and at least numSamples samples. */
+    static MappedStimulus *createFor(const File &file, int numChannels, int64 numSamples);
+
+private:
+    MappedStimulus(MemoryMappedFile *map, const char *sampleData, int numChannels, int bytesPerSample,
+                   SampleConverter converter);
+
+    std::unique_ptr <MemoryMappedFile> map;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedStimulus);
+};
+
+
+/**
+    Integer samples of a stimulus packed into memory at 2 or 3 bytes per sample.
+*/
+class PackedAudio {
+public:
+    PackedAudio(int numChannels, int numSamples, int bytesPerSample);
+
+    int64 getNumBytes() const { return (int64) numChannels * numSamples * bytesPerSample; }
+
+    HeapBlock<char> data;
+    const int numChannels;
+    const int numSamples;
+    const int bytesPerSample;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PackedAudio);
+};
+
+typedef std::shared_ptr<const PackedAudio> SharedPackedAudio;
+
+
+/**
+    Stimulus decoded into packed 16 or 24 bit integers, which takes half or three quarters
+    of the memory of a float buffer and plays back bit-exact with it.
+*/
+class PackedStimulus : public InterleavedStimulus {
+public:
+    explicit PackedStimulus(SharedPackedAudio audio);
+
+    /* Reads an integer PCM file into packed samples.  bytesPerSample must not be less than
+       the file's own sample size for the result to be exact. */
+    static SharedPackedAudio decode(AudioFormatReader *reader, int numChannels, int numSamples, int bytesPerSample);
+
+    /* The packed size, 2 or 3 bytes, that holds reader's samples exactly without going above
+       maxBytesPerSample; 0 if the file has to be kept as float. */
+    static int getPackedBytesPerSample(const AudioFormatReader &reader, int maxBytesPerSample);
+
+private:
+    SharedPackedAudio audio;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PackedStimulus);
+};
+
+#endif /* STIMULUS_SOURCE_H */
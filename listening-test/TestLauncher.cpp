@@ -18,15 +18,67 @@ TestLauncher::TestLauncher(AudioPlayer &aPlayer) :
         currentIndex(-1),
         testComplete(false),
         fileLogger(FileLogger::createDefaultAppLogger("ListeningTest", "listening-test.log.txt", String(), 0)),
+        stimulusLoader(playbackSettings, aPlayer.getStreamingThread(), aPlayer.getStimulusCache(), *fileLogger),
+        prefetcher(stimulusLoader, *fileLogger),
         testStartTime(Time::getCurrentTime()),
+        resultsReplicator(*fileLogger),
+        resultsWriter(*fileLogger, resultsReplicator),
+        interactionLog(resultsReplicator, *fileLogger),
+        journalStarted(false),
+        journalRecords(0),
+        journalSequence(0),
+        journaledIndex(-1),
         resultsDirectory(String()),
         inputChannels(0),
-        surveyResultsXml("surveySkipped") {}
+        requiredOutputChannels(0),
+        stimulusSampleRate(0.0),
+        surveyResultsXml("surveySkipped") {
+    audioPlayer.setInteractionLog(&interactionLog);
+    audioPlayer.setLogger(fileLogger.get());
+}
 
 TestLauncher::~TestLauncher() {
+    /* the session ends here; put what the journal holds back into the results file */
+    if (journalRecords > 0) {
+        audioPlayer.flushPlaybackLog();
+        collectPlaybackCounts();
+        compactResults();
+    }
+    resultsWriter.waitUntilWritten(-1);
+    audioPlayer.setInteractionLog(nullptr);
+    audioPlayer.setLogger(nullptr);
+    audioPlayer.stopPlaybackLog();
+    logPlaybackDiagnostics();
+}
+
+void TestLauncher::startInteractionLog() {
+    String fileName = testID + "_" + Time::getCurrentTime().formatted("%Y-%m-%d_%H%M%S_") + subjectID +
+                      "_interactions.bin";
+    File logFile(File::addTrailingSeparator(stimuliDirectory) + fileName.replaceCharacter(' ', '_'));
+
+    /* written to the spool and copied from there like the results; failures are logged */
+    interactionLog.open(logFile);
+    dbgOut("Recording listener interactions to " + logFile.getFullPathName());
+}
+
+void TestLauncher::recordInteraction(InteractionEvent::Type type, int stimulus, double value) {
+    interactionLog.record(type, stimulus, value, audioPlayer.getCurrentSample(), audioPlayer.getRenderedSamples());
+}
+
+void TestLauncher::logPlaybackDiagnostics() {
+    audioPlayer.updateDiagnostics();
+    PlaybackDiagnostics &diagnostics = audioPlayer.getDiagnostics();
+    if (diagnostics.getNumCallbacks() > 0) {
+        dbgOut(diagnostics.getSummary());
+    }
+    diagnostics.reset();
 }
 
 bool TestLauncher::init(File testSettingsFile) {
+    prefetcher.cancel();
+    resultsWriter.waitUntilWritten(-1);
+    journalStarted = false;
+    journalSequence = 0;
     std::unique_ptr <XmlElement> testSettings(parseXML(testSettingsFile));
 
     stimuliDirectory = testSettings->getStringAttribute("stimuliDirectory");
@@ -36,6 +88,7 @@ bool TestLauncher::init(File testSettingsFile) {
     if (!trialsPerSessionString.equalsIgnoreCase("all")) {
         trialsPerSession = trialsPerSessionString.getIntValue();
     }
+    playbackSettings.loadFromXml(*testSettings);
     dbgOut(String::formatted("%s test loaded", static_cast<const char *> (testTypes[testType].toUTF8())));
     randomiseStimuli = true;
     if (testType == TEST_TYPE_MUSHRA_DEMO) {
@@ -48,9 +101,10 @@ bool TestLauncher::init(File testSettingsFile) {
     }
 
     debugTrialSettings();
+    startInteractionLog();
 
     /* load audio stimuli */
-    runThread();
+    loadCurrentTrial();
 
     if (!lastError.isEmpty()) {
         return false;
@@ -94,14 +148,15 @@ bool TestLauncher::goToTrial(int trialIndex) {
 
     if ((trialIndex >= 0) && (trialIndex < trials.size())) {
         trials[currentIndex]->setStopTime();
+        collectPlaybackCounts();
         currentIndex = trialIndex;
 
-        if (trialsPerSession != -1 && trialsThisSession >= trialsPerSession) {
+        if (isSessionComplete()) {
             return false;
         }
 
         dbgOut("\t Starting trial " + String(currentIndex) + "\t" + trials[currentIndex]->testName);
-        runThread();
+        loadCurrentTrial();
         trials[currentIndex]->setStartTime();
         trials[currentIndex]->setStopTime();
         return true;
@@ -122,9 +177,10 @@ bool TestLauncher::readTestSettings() {
         return false;
     }
 
-    /* get the child directories */
-    Array <File> childDir;
-    int dirCount = stimDir->findChildFiles(childDir, File::findDirectories, true);
+    /* get the child directories; only those that changed since the last test are listed again */
+    stimulusIndex.update(*stimDir);
+    Array <File> childDir(stimulusIndex.getDirectories(true));
+    int dirCount = childDir.size();
     if (dirCount == 0) {
         lastError = "Unable to find subdirectories in " + stimuliDirectory;
         return false;
@@ -162,6 +218,9 @@ bool TestLauncher::readTestSettings() {
     }
 
     /* fill trials array */
+    audioPlayer.stopPlaybackLog();
+    collectPlaybackCounts();
+    logPlaybackDiagnostics();
     trials.clear();
 
     if (testType == TEST_TYPE_BS1116) {
@@ -173,8 +232,8 @@ bool TestLauncher::readTestSettings() {
 
         for (int d = 0; d < dirCount; d++) {
             /* get list of all files in this directory */
-            Array <File> filesFound;
-            if (int stimFound = childDir[d].findChildFiles(filesFound, File::findFiles, false, "*.wav") != stimCount) {
+            Array <File> filesFound(stimulusIndex.getFiles(childDir[d], "*.wav"));
+            if (int stimFound = filesFound.size() != stimCount) {
                 lastError = String(stimFound) + " stimuli were found in " + childDir[d].getFullPathName() + "; " +
                             String(stimCount) +
                             " were expected.  Try rerunning 'manage tests' if all files are where they should be.";
@@ -231,9 +290,9 @@ bool TestLauncher::readTestSettings() {
 
         for (int d = 0; d < dirCount; d++) {
             /* get list of all files in this directory */
-            Array <File> filesFound;
+            Array <File> filesFound(stimulusIndex.getFiles(childDir[d], "*.wav"));
             int nPairs = 0;
-            int stimFound = childDir[d].findChildFiles(filesFound, File::findFiles, false, "*.wav");
+            int stimFound = filesFound.size();
             if (stimFound != stimCount) {
                 lastError = String(stimFound) + " stimuli were found in " + childDir[d].getFullPathName() + "; " +
                             String(stimCount) +
@@ -250,8 +309,8 @@ bool TestLauncher::readTestSettings() {
             }
 
             if (testType == TEST_TYPE_AVAB) {
-                filesFound.clear();
-                int vidsFound = childDir[d].findChildFiles(filesFound, File::findFiles, false, "*.mp4");
+                filesFound = stimulusIndex.getFiles(childDir[d], "*.mp4");
+                int vidsFound = filesFound.size();
                 if (vidsFound != 1) {
                     lastError = String(vidsFound) + " video files were found in " + childDir[d].getFullPathName() +
                                 "; 1 was expected.  I only search for *.mp4 files.  Try rerunning 'manage tests' if all files are where they should be.";
@@ -310,8 +369,8 @@ bool TestLauncher::readTestSettings() {
             trials[i]->videoFile = new File(String());
 
             /* get stimuli files */
-            Array <File> stimuliFiles;
-            int stimFound = childDir[trialIndexLookup[i]].findChildFiles(stimuliFiles, File::findFiles, false, "*.wav");
+            Array <File> stimuliFiles(stimulusIndex.getFiles(childDir[trialIndexLookup[i]], "*.wav"));
+            int stimFound = stimuliFiles.size();
 
             if (stimFound != stimCount) {
                 lastError = "The number of stimuli found in " + childDir[trialIndexLookup[i]].getFullPathName()
@@ -376,7 +435,19 @@ bool TestLauncher::readTestSettings() {
 }
 
 bool TestLauncher::loadResults(File &resultsFile) {
-    std::unique_ptr <XmlElement> testResults(parseXML(resultsFile));
+    prefetcher.cancel();
+    /* the file may be one this session is still writing */
+    resultsWriter.waitUntilWritten(-1);
+    journalStarted = false;
+    journalSequence = 0;
+
+    /* results that have not been copied to the stimuli directory yet are still in the spool */
+    const File newestCopy(ResultsReplicator::getNewestCopy(resultsFile));
+    if (newestCopy != resultsFile) {
+        dbgOut("Loading the local copy " + newestCopy.getFullPathName() + " of " + resultsFile.getFullPathName());
+    }
+
+    std::unique_ptr <XmlElement> testResults(parseXML(newestCopy));
     if (testResults == nullptr) {
         lastError = "could not parse xml in " + resultsFile.getFileName();
         dbgOut(lastError);
@@ -392,8 +463,13 @@ bool TestLauncher::loadResults(File &resultsFile) {
         return false;
     }
 
+    /* the trials completed since the file was last written in full */
+    replayJournal(newestCopy, *testResults);
+
     testStartTime.fromISO8601(testInfo->getStringAttribute("startTime", String()));
 
+    playbackSettings.loadFromXml(*testInfo);
+
     subjectID = testInfo->getStringAttribute("subjectName", String());
     if (subjectID.isEmpty()) {
         lastError = "No subject ID found in " + resultsFile.getFileName();
@@ -442,6 +518,9 @@ bool TestLauncher::loadResults(File &resultsFile) {
         return false;
     }
 
+    audioPlayer.stopPlaybackLog();
+    collectPlaybackCounts();
+    logPlaybackDiagnostics();
     trials.clear();
     trialsCount = trialsInfo->getNumChildElements();
     if (trialsCount < 1) {
@@ -494,175 +573,352 @@ bool TestLauncher::loadResults(File &resultsFile) {
         stimCount = trials[0]->soundFiles.size();
     }
 
+    startInteractionLog();
     goToTrial(currentIndex);
     trialsThisSession = 0;
     
-    runThread();
+    loadCurrentTrial();
     return lastError.isEmpty();
 }
 
+void TestLauncher::replayJournal(const File &resultsFile, XmlElement &testResults) {
+    XmlElement *testInfo = testResults.getChildByName("info");
+    XmlElement *trialsInfo = testResults.getChildByName("trials");
+    if (testInfo == nullptr || trialsInfo == nullptr)
+        return;
+
+    const File journalFile(resultsFile.withFileExtension("journal"));
+    OwnedArray <XmlElement> records;
+    if (!ResultsJournal::read(journalFile, records)) {
+        dbgOut("The last record of " + journalFile.getFullPathName() + " was cut short and is ignored");
+    }
+
+    journalSequence = testInfo->getStringAttribute("journalSequence", "0").getLargeIntValue();
+    int replayed = 0;
+    for (int r = 0; r < records.size(); r++) {
+        const XmlElement *record = records[r];
+        const int64 sequence = record->getStringAttribute("sequence", "0").getLargeIntValue();
+        if (!record->hasTagName("resultsUpdate") || sequence <= journalSequence)
+            continue;
+
+        for (int i = 0; i < record->getNumChildElements(); i++) {
+            const XmlElement *update = record->getChildElement(i);
+            XmlElement *savedTrial = trialsInfo->getChildElement(update->getIntAttribute("index", -1));
+            if (update->hasTagName("trialUpdate") && savedTrial != nullptr && update->getFirstChildElement() != nullptr) {
+                trialsInfo->replaceChildElement(savedTrial, new XmlElement(*update->getFirstChildElement()));
+            }
+        }
+        testInfo->setAttribute("currentTrial", record->getIntAttribute("currentTrial"));
+        testInfo->setAttribute("stopTime", record->getStringAttribute("stopTime"));
+        journalSequence = sequence;
+        replayed++;
+    }
+
+    if (replayed > 0) {
+        dbgOut("Replayed " + String(replayed) + " results updates from " + journalFile.getFullPathName());
+    }
+}
+
 bool TestLauncher::saveResults() {
-    String resultFile;
+    audioPlayer.flushPlaybackLog();
+    collectPlaybackCounts();
+
+    /* within a session only the trials that changed go to the journal; the whole file is
+       written when the session starts and ends, and when the journal could not be written */
+    if (journalStarted && resultsWriter.isJournalUsable() && !isTestComplete() && !isSessionComplete()) {
+        appendToJournal();
+        return true;
+    }
+
+    return compactResults();
+}
+
+File TestLauncher::getTempResultsFile() {
+    return File(File::addTrailingSeparator(stimuliDirectory) + "temp_" + subjectID + ".xml");
+}
+
+void TestLauncher::appendToJournal() {
+    std::unique_ptr <XmlElement> record(new XmlElement("resultsUpdate"));
+    record->setAttribute("sequence", String(journalSequence + 1));
+    record->setAttribute("stopTime", Time::getCurrentTime().toISO8601(true));
+    record->setAttribute("currentTrial", getCurrentTrialIndex());
+
+    /* only the trial that was current at the last save and the current one can have changed */
+    for (int i = 0; i < trialsCount; i++) {
+        if (i == journaledIndex || i == currentIndex) {
+            XmlElement *update = record->createNewChildElement("trialUpdate");
+            update->setAttribute("index", i);
+            trials[i]->saveResults(update);
+        }
+    }
+
+    resultsWriter.appendToJournal(std::move(record), getTempResultsFile());
+    ++journalSequence;
+    ++journalRecords;
+    journaledIndex = currentIndex;
+}
+
+bool TestLauncher::compactResults() {
+    File fs;
     if (isTestComplete()) {
         String tmpString = testID + "_" + Time::getCurrentTime().formatted("%Y-%m-%d_%H%M%S_") + subjectID + ".xml";
-        resultFile = File::addTrailingSeparator(stimuliDirectory) + tmpString.replaceCharacter(' ', '_');
+        fs = File(File::addTrailingSeparator(stimuliDirectory) + tmpString.replaceCharacter(' ', '_'));
     } else {
-        resultFile = File::addTrailingSeparator(stimuliDirectory) + "temp_" + subjectID + ".xml";
+        fs = getTempResultsFile();
     }
 
-    File fs(resultFile);
     if (fs == File()) {
-        lastError = "Unable to create output file " + resultFile;
+        lastError = "Unable to create output file in " + stimuliDirectory;
         dbgOut(lastError);
         return false;
     }
 
-    if (fs.existsAsFile()) {
-        dbgOut("Deleting existing file:\t" + resultFile);
-        fs.deleteFile();
-    } else {
-        Result resCreate = fs.create();
-        if (resCreate.failed()) {
-            dbgOut("Unable to create directory:\t" + fs.getFullPathName() + ".Error message: " +
-                   resCreate.getErrorMessage());
-
-            File docFolder(File::getSpecialLocation(File::userDocumentsDirectory));
-            File mFolder(docFolder.getChildFile("ListeningTest"));
-
-            if (!mFolder.isDirectory()) {
-                Result res = mFolder.createDirectory();
-                if (res.failed()) {
-                    lastError = res.getErrorMessage();
-                    dbgOut(lastError);
-                    return false;
-                }
-            }
+    std::unique_ptr <XmlElement> testResults(new XmlElement(testTypes[testType]));
 
-            fs = mFolder.getChildFile(fs.getFileName());
-            resultsDirectory = fs.getParentDirectory().getFullPathName();
-        }
-    }
-
-    XmlElement testResults(testTypes[testType]);
-
-    XmlElement testInfo("info");
-    testInfo.setAttribute("startTime", testStartTime.toISO8601(true));
-    testInfo.setAttribute("stopTime", Time::getCurrentTime().toISO8601(true));
-    testInfo.setAttribute("subjectName", subjectID);
-    testInfo.setAttribute("testName", testID);
-    testInfo.setAttribute("stimuliDirectory", stimuliDirectory);
+    XmlElement *testInfo = testResults->createNewChildElement("info");
+    testInfo->setAttribute("startTime", testStartTime.toISO8601(true));
+    testInfo->setAttribute("stopTime", Time::getCurrentTime().toISO8601(true));
+    testInfo->setAttribute("subjectName", subjectID);
+    testInfo->setAttribute("testName", testID);
+    testInfo->setAttribute("stimuliDirectory", stimuliDirectory);
     if (trialsPerSession == -1) {
-        testInfo.setAttribute("trialsPerSession", "all");
+        testInfo->setAttribute("trialsPerSession", "all");
     } else {
-        testInfo.setAttribute("trialsPerSession", trialsPerSession);
+        testInfo->setAttribute("trialsPerSession", trialsPerSession);
     }
-    testInfo.setAttribute("testStatus", isTestComplete() ? "complete" : "incomplete");
+    playbackSettings.saveToXml(*testInfo);
+    testInfo->setAttribute("testStatus", isTestComplete() ? "complete" : "incomplete");
     if (!isTestComplete()) {
-        testInfo.setAttribute("currentTrial", getCurrentTrialIndex());
+        testInfo->setAttribute("currentTrial", getCurrentTrialIndex());
+        testInfo->setAttribute("journalSequence", String(journalSequence));
     }
 
-    testResults.addChildElement(new XmlElement(testInfo));
-    
     if (surveyResultsXml.getTagName() != "surveySkipped") {
-        testResults.addChildElement(new XmlElement(surveyResultsXml));
+        testResults->addChildElement(new XmlElement(surveyResultsXml));
     }
 
-    XmlElement trialsXml("trials");
+    XmlElement *trialsXml = testResults->createNewChildElement("trials");
     for (int i = 0; i < trialsCount; i++) {
-        trials[i]->saveResults(&trialsXml);
+        trials[i]->saveResults(trialsXml);
     }
 
-    testResults.addChildElement(new XmlElement(trialsXml));
-
-    testResults.writeTo(fs);
+    /* the writer thread takes it from here; it also starts the journal of the next trials */
+    resultsWriter.writeResults(std::move(testResults), fs, !isTestComplete());
+    journalStarted = !isTestComplete();
+    journalRecords = 0;
+    journaledIndex = currentIndex;
 
     return true;
 }
 
-void TestLauncher::run() {
-    audioPlayer.releaseAllAudioData();
-    lastError = String();
-
-    Array <int64> samplesCountPerFile;
-    WavAudioFormat waf;
-
-    // Get the channel count and validate consistency
-    // First get sample count and use shortest input file as length for all
-    for (int i = 0; i < getCurrentTrial()->soundFiles.size(); i++) {
-        /* Create input stream for the audio file */
-        FileInputStream *af = new FileInputStream(File(getCurrentTrial()->soundFiles[i]));
-
-        if (af->failedToOpen()) {
-            lastError = String::formatted("Could not open file %s.",
-                                          getCurrentTrial()->soundFiles[i].toWideCharPointer());
+void TestLauncher::loadCurrentTrial() {
+    /* stimuli recorded at another rate than the device's are resampled while loading */
+    stimulusLoader.setTargetSampleRate(audioPlayer.getSampleRate());
+
+    if (prefetcher.getTrialIndex() == currentIndex && prefetcher.isReady()) {
+        std::unique_ptr <StimulusSet> set(prefetcher.take(currentIndex));
+        if (set != nullptr && set->sampleRate == stimulusLoader.getTargetSampleRate()) {
+            dbgOut("Using prefetched stimuli for trial " + String(currentIndex));
+            lastError = String();
+            installStimulusSet(std::move(set));
+            prefetchNextTrial();
             return;
         }
+    }
 
-        std::unique_ptr <AudioFormatReader> wavReader(waf.createReaderFor(af, false));
-        samplesCountPerFile.add(wavReader->lengthInSamples);
-
-        if (i == 0) {
-            inputChannels = wavReader->numChannels;
-        } else if (wavReader->numChannels != inputChannels) {
-            lastError = String::formatted("The number of audio channels in %s is %i; expected %i",
-                                          getCurrentTrial()->soundFiles[i].toWideCharPointer(),
-                                          inputChannels,
-                                          audioPlayer.getChannelCount());
-            return;
-        }
+    /* run() only loads; the player and the interaction log are the message thread's */
+    runThread();
+    if (loadedSet != nullptr) {
+        installStimulusSet(std::move(loadedSet));
     }
+    prefetchNextTrial();
+}
 
-    int64 maxSamplesCount = 0;
-    samplesCount = static_cast<unsigned int> (samplesCountPerFile[0]);
-    for (int i = 1; i < samplesCountPerFile.size(); i++) {
-        maxSamplesCount = min(maxSamplesCount, samplesCountPerFile[i]);
-        if (maxSamplesCount > (int64)(UINT_MAX)) {
-            lastError = String::formatted("Sorry, I cannot open %s because it has more than %n samples per channel",
-                                          getCurrentTrial()->soundFiles[i].toUTF8(), UINT_MAX);
-            return;
-        }
+void TestLauncher::installStimulusSet(std::unique_ptr <StimulusSet> set) {
+    /* a reload within the trial, after a device change, keeps what was counted so far */
+    collectPlaybackCounts();
+    audioPlayer.startCountingGlitches();
+    if (getCurrentTrial() != nullptr && getCurrentTrial()->auditionBaseTicks == 0) {
+        getCurrentTrial()->auditionBaseTicks = Time::getHighResolutionTicks();
     }
 
-    if ((BigInteger) inputChannels > audioPlayer.getOutputChannels()) {
+    inputChannels = set->channelCount;
+    samplesCount = set->samplesCount;
+    stimulusSampleRate = set->sampleRate;
+
+    RoutingMatrix routing;
+    lastError = resolveRouting(inputChannels, routing);
+    if (lastError.isNotEmpty())
+        return;
+
+    requiredOutputChannels = routing.getNumOutputsNeeded(inputChannels);
+    if (requiredOutputChannels > audioPlayer.getNumOutputChannels()) {
         lastError = "The number of audio channels in stimuli files exceeds available device outputs.";
         return;
     }
 
-    audioPlayer.setTotalSamples(samplesCount);
-    audioPlayer.setChannelCount(inputChannels);
+    if (getPlaybackSettings().loudness != LOUDNESS_OFF) {
+        getCurrentTrial()->loudness = set->loudness;
+        getCurrentTrial()->levelGains = set->gains;
+    }
 
-    // Load input files into memory
+    /* what is needed to render this trial's playback again offline */
+    PlaybackLog *log = new PlaybackLog;
+    log->sampleRate = set->sampleRate;
+    log->channelCount = set->channelCount;
     for (int i = 0; i < getCurrentTrial()->soundFiles.size(); i++) {
-        setProgress((float) i / getCurrentTrial()->soundFiles.size());
-        if (threadShouldExit())
-            break;
+        log->fileNames.add(File(getCurrentTrial()->soundFiles[i]).getFileName());
+    }
+    log->gains = set->gains;
+    log->routing = routing;
+    log->crossfadeMs = playbackSettings.crossfadeMs;
+    log->crossfadeShape = playbackSettings.crossfadeShape;
+    log->loopCrossfadeSamples = playbackSettings.loopCrossfadeSamples;
+    log->streamed = playbackSettings.stimulusStorage == STIMULUS_STORAGE_STREAM;
+    getCurrentTrial()->playbackLogs.add(log);
 
-        /* Create input stream for the audio file */
-        FileInputStream *af = new FileInputStream(getCurrentTrial()->soundFiles[i]);
+    audioPlayer.setRouting(routing);
+    audioPlayer.setStimulusSet(std::move(set));
+    audioPlayer.setCrossfade(playbackSettings.crossfadeMs, playbackSettings.crossfadeShape,
+                             playbackSettings.loopCrossfadeSamples);
+    audioPlayer.startPlaybackLog(log);
 
-        if (af->failedToOpen()) {
-            lastError = String::formatted("Could not open file %s.",
-                                          getCurrentTrial()->soundFiles[i].toWideCharPointer());
-            return;
+    interactionLog.setTrial(currentIndex);
+    recordInteraction(InteractionEvent::trial, -1, stimulusSampleRate);
+
+    if (getCurrentTrial()->videoFile->exists()) {
+        dbgOut("Loading video file " + getCurrentTrial()->videoFile->getFullPathName());
+        audioPlayer.setVideoFile(*getCurrentTrial()->videoFile);
+    }
+}
+
+void TestLauncher::collectPlaybackCounts() {
+    collectGlitches();
+    collectListeningTime();
+}
+
+void TestLauncher::collectListeningTime() {
+    Trial *trial = getCurrentTrial();
+    const double rate = stimulusSampleRate > 0.0 ? stimulusSampleRate : 1.0;
+
+    for (int i = 0; trial != nullptr && i < trial->soundFiles.size(); i++) {
+        const int64 samples = audioPlayer.takeListenedSamples(i);
+        while (trial->listenedSeconds.size() <= i) {
+            trial->listenedSeconds.add(0.0);
         }
+        trial->listenedSeconds.getReference(i) += samples / rate;
+    }
 
-        std::unique_ptr <AudioFormatReader> wavReader(waf.createReaderFor(af, false));
-        if (wavReader == NULL) {
-            lastError = "Unable to create reader for  " + getCurrentTrial()->soundFiles[i];
-            return;
+    Audition audition;
+    while (audioPlayer.popAudition(audition)) {
+        if (trial == nullptr)
+            continue;
+
+        const TrialAudition trialAudition = {audition.stimulus, audition.loopStart / rate, audition.loopEnd / rate,
+                                             audition.looping, audition.samples / rate,
+                                             Time::highResolutionTicksToSeconds(audition.startTicks
+                                                                                - trial->auditionBaseTicks)};
+        trial->auditions.add(trialAudition);
+    }
+
+    if (audioPlayer.takeAuditionsLost()) {
+        dbgOut("Some auditions of trial " + String(currentIndex) + " were lost; its listening times are complete");
+    }
+}
+
+void TestLauncher::collectGlitches() {
+    const PlaybackGlitches glitches = audioPlayer.takeGlitches();
+    if (getCurrentTrial() == nullptr || !glitches.any())
+        return;
+
+    getCurrentTrial()->glitches += glitches;
+    dbgOut(String::formatted("Dropouts while playing trial %d: %d xrun(s), %d late callback(s), %d device restart(s)",
+                             currentIndex, glitches.xruns, glitches.lateCallbacks, glitches.restarts));
+}
+
+String TestLauncher::resolveRouting(int numInputs, RoutingMatrix &result) {
+    if (playbackSettings.routingError.isNotEmpty())
+        return playbackSettings.routingError;
+
+    String error;
+    result = playbackSettings.routing.resolve(numInputs, error);
+    if (error.isNotEmpty())
+        return error;
+
+    if (stationRoutingFile.existsAsFile()) {
+        std::unique_ptr <XmlElement> stationXml(parseXML(stationRoutingFile));
+        if (stationXml == nullptr || !stationXml->hasTagName("routing"))
+            return "Cannot read a <routing> element from " + stationRoutingFile.getFullPathName();
+
+        RoutingMatrix stationRouting;
+        error = stationRouting.loadFromXml(*stationXml);
+        if (error.isEmpty()) {
+            const RoutingMatrix resolved(stationRouting.resolve(result.getNumOutputsNeeded(numInputs), error));
+            result = result.followedBy(resolved);
         }
+        if (error.isNotEmpty())
+            return stationRoutingFile.getFileName() + ": " + error;
+    }
+
+    return String();
+}
+
+bool TestLauncher::reloadIfSampleRateChanged() {
+    if (currentIndex < 0 || currentIndex >= trials.size() || stimulusSampleRate == 0.0 ||
+        roundToInt(stimulusSampleRate) == audioPlayer.getSampleRate())
+        return false;
+
+    dbgOut("Device sample rate changed from " + String(stimulusSampleRate) + " Hz to " +
+           String(audioPlayer.getSampleRate()) + " Hz; reloading trial " + String(currentIndex));
 
-        dbgOut("Loading file " + af->getFile().getFullPathName());
-        audioPlayer.addAudioFromFile(wavReader.get(), inputChannels, samplesCount);
+    const bool wasRunning = audioPlayer.isRunning();
+    audioPlayer.stop();
+    prefetcher.cancel();
+    loadCurrentTrial();
+    if (wasRunning) {
+        audioPlayer.start();
     }
+    return true;
+}
 
-    if (getCurrentTrial()->videoFile->exists()) {
-        dbgOut("Loading video file " + getCurrentTrial()->videoFile->getFullPathName());
-        audioPlayer.setVideoFile(*getCurrentTrial()->videoFile);
+void TestLauncher::prefetchNextTrial() {
+    const int nextIndex = currentIndex + 1;
+    const bool sessionEnds = trialsPerSession != -1 && trialsThisSession + 1 >= trialsPerSession;
+
+    if (lastError.isEmpty() && !sessionEnds && nextIndex < trials.size()) {
+        prefetcher.prefetch(*trials[nextIndex], nextIndex);
+    }
+}
+
+void TestLauncher::run() {
+    lastError = String();
+    loadedSet.reset();
+    std::unique_ptr <StimulusSet> set;
+
+    /* the trial may still be loading in the background: wait for it rather than start over */
+    if (prefetcher.getTrialIndex() == currentIndex) {
+        while (prefetcher.isThreadRunning() && !threadShouldExit()) {
+            setProgress(prefetcher.getProgress());
+            wait(20);
+        }
+        if (!threadShouldExit()) {
+            set = prefetcher.take(currentIndex);
+        }
+    }
+    prefetcher.cancel();
+
+    if (set == nullptr) {
+        audioPlayer.releaseAllAudioData();
+        set.reset(new StimulusSet);
+        set->trialIndex = currentIndex;
+
+        lastError = stimulusLoader.load(*getCurrentTrial(), *this, [this](double p) { setProgress(p); }, *set);
+        if (lastError.isNotEmpty())
+            return;
     }
 
+    loadedSet = std::move(set);
     setProgress(1.0);
-    wait(500);
 }
 
 void TestLauncher::incrementPlayCount(int i) {
@@ -8,9 +8,13 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "AudioPlayer.h"
+#include "StimulusSet.h"
 #include "Trial.h"
 #include "SurveyComponent.h"
 #include "TestTypes.h"
+#include "PlaybackSettings.h"
+#include "ResultsWriter.h"
+#include "StimulusIndex.h"
 
 
 void randomizeArrayOrder(Array<int> &anArray);
@@ -40,8 +44,13 @@ public:
 
     testEnum getTestType() { return testType; };
 
+    const PlaybackSettings &getPlaybackSettings() { return playbackSettings; }
+
     int getInputChannels() { return inputChannels; }
 
+    /* device outputs the current trial needs once its channels are routed */
+    int getRequiredOutputChannels() { return requiredOutputChannels; }
+
     int getPlayCount(int index);
 
     int getReferencePlayCount() { return getCurrentTrial()->refPlays; }
@@ -66,26 +75,85 @@ public:
 
     bool isTestComplete() { return testComplete; }
 
+    /* true once the subject has done the trials of this session */
+    bool isSessionComplete() { return trialsPerSession != -1 && trialsThisSession >= trialsPerSession; }
+
     /* initialise and test parameters */
     bool init(File testSettingsFile);
 
     /* save results of listening test -- TODO, these will move into individual test classes */
     bool loadResults(File &resultsFile);
 
+    /* Saves the trials that changed since the last call.  Within a session they are appended to a
+       journal next to the results file; at the start and end of a session, and when the journal
+       cannot be written, the whole file is written instead.  The writing happens on a background
+       thread; failures are reported by the results writer. */
     bool saveResults();
 
+    /* waits until the results saved so far are on the disk */
+    void waitForResults() { resultsWriter.waitUntilWritten(-1); }
+
+    /* sends a change message when results could not be written */
+    ResultsWriter &getResultsWriter() { return resultsWriter; }
+
+    /* sends a change message when copying results to the stimuli directory progresses or fails */
+    ResultsReplicator &getResultsReplicator() { return resultsReplicator; }
+
+    /* reloads the current trial when the device now runs at another rate than its stimuli were loaded
+       for; returns true if it did */
+    bool reloadIfSampleRateChanged();
+
     void dbgOut(const String msg) { fileLogger->logMessage(msg); }
 
     void incrementPlayCount(int index);
 
     void incrementReferencePlayCount();
 
+    /* adds something the listener did in the current trial to the session's interaction log */
+    void recordInteraction(InteractionEvent::Type type, int stimulus, double value);
+
     void run();
 
 
 private:
     void debugTrialSettings();
 
+    /* the results file of a test that is not complete yet */
+    File getTempResultsFile();
+
+    /* queues the current and the previously saved trial for the journal */
+    void appendToJournal();
+
+    /* queues the whole results file, replacing it in one step, followed by an empty journal */
+    bool compactResults();
+
+    /* applies the records of the results file's journal to its xml, skipping those already in it */
+    void replayJournal(const File &resultsFile, XmlElement &testResults);
+
+    /* makes the stimuli of the current trial playable, from the prefetcher when it has them */
+    void loadCurrentTrial();
+
+    /* message thread only */
+    void installStimulusSet(std::unique_ptr <StimulusSet> set);
+
+    void prefetchNextTrial();
+
+    /* adds what the player counted since the last call, glitches and listening time, to the current trial */
+    void collectPlaybackCounts();
+
+    void collectGlitches();
+
+    void collectListeningTime();
+
+    /* starts the interaction log of a new session next to the results */
+    void startInteractionLog();
+
+    /* writes the playback diagnostics of the session that is ending to the log, and starts new ones */
+    void logPlaybackDiagnostics();
+
+    /* the test's routing followed by the station's, for stimuli with numInputs channels */
+    String resolveRouting(int numInputs, RoutingMatrix &result);
+
     AudioPlayer &audioPlayer;
 
     String subjectID;
@@ -95,6 +163,7 @@ private:
     OwnedArray <Trial> trials;
     int stimCount = 0;
     testEnum testType;
+    PlaybackSettings playbackSettings;
     int trialsCount;
     int trialsPerSession;
     int trialsThisSession;
@@ -102,15 +171,29 @@ private:
     bool testComplete;
 
     std::unique_ptr <FileLogger> fileLogger;
+    StimulusLoader stimulusLoader;
+    StimulusPrefetcher prefetcher;
+    std::unique_ptr <StimulusSet> loadedSet;    // left by run() for loadCurrentTrial() to install
+    StimulusIndex stimulusIndex;
     Time testStartTime;
 
-    unsigned int samplesCount;
+    ResultsReplicator resultsReplicator;
+    ResultsWriter resultsWriter;
+    InteractionLog interactionLog;      // after the replicator, which it hands its file to
+    bool journalStarted;        // the last results queued started a journal
+    int journalRecords;         // records queued for the journal since
+    int64 journalSequence;      // of the last record queued for or read from the journal
+    int journaledIndex;         // current trial at the last save
+
+    int64 samplesCount;
 
     bool readTestSettings();
 
     String resultsDirectory;
 
     int inputChannels;
+    int requiredOutputChannels;
+    double stimulusSampleRate;
     
     XmlElement surveyResultsXml;
 
@@ -5,6 +5,7 @@
 
 #include "TestManagerComponent.h"
 #include "guisettings.h"
+#include "StimulusIndex.h"
 
 const int border = 20;
 
@@ -241,21 +242,36 @@ void TestManagerComponent::TestManagerListBox::deleteTest() {
 }
 
 bool TestManagerComponent::TestManagerListBox::validateData() {
+    StimulusIndex stimulusIndex;
     for (int i = 0; i < rowsCount; ++i) {
         String errStr(0);
         String testName = tableData->getChildElement(i)->getStringAttribute("name");
         File stimDir(tableData->getChildElement(i)->getStringAttribute("stimuliDirectory"));
-        if (stimDir.isDirectory()) {
-            Array <File> tmpDir;
-            int trialsFound = stimDir.findChildFiles(tmpDir, File::findDirectories, false);
-            int stimInFirstTrial = tmpDir[0].getNumberOfChildFiles(File::findFiles, "*.wav");
-            for (int j = 1; j < trialsFound; ++j) {
-                int stimFound = tmpDir[j].getNumberOfChildFiles(File::findFiles, "*.wav");
+        if (stimulusIndex.update(stimDir)) {
+            Array <File> tmpDir(stimulusIndex.getDirectories(false));
+            int trialsFound = tmpDir.size();
+            int stimInFirstTrial = stimulusIndex.getFiles(tmpDir[0], "*.wav").size();
+            for (int j = 0; j < trialsFound; ++j) {
+                Array <File> stimuli(stimulusIndex.getFiles(tmpDir[j], "*.wav"));
+                int stimFound = stimuli.size();
                 if (stimFound != stimInFirstTrial) {
                     errStr = String("The number of stimuli in different trials were not the same.\n" \
                                   "Found " + String(stimFound) + " stimuli in directory \"" + tmpDir[j].getFileName() +
                                     "\"; expected " + String(stimInFirstTrial));
                 }
+
+                /* the headers were read when the files were indexed; a file is only reported after
+                   looking at it again */
+                for (int k = 0; k < stimFound; ++k) {
+                    const StimulusIndex::IndexedFile *info = stimulusIndex.getFileInfo(stimuli[k]);
+                    if (info != nullptr && info->numChannels == 0) {
+                        info = stimulusIndex.refreshFileInfo(stimuli[k]);
+                    }
+                    if (info != nullptr && info->numChannels == 0) {
+                        errStr = String("\"" + stimuli[k].getFileName() + "\" in directory \"" + tmpDir[j].getFileName() +
+                                        "\" could not be read as a WAV file");
+                    }
+                }
             }
 
             tableData->getChildElement(i)->setAttribute("stimuliCount", stimInFirstTrial);
@@ -34,4 +34,19 @@ const File workingDirectory(
         "ListeningTest");
 const File audioDeviceSettingsFile(workingDirectory.getChildFile("audioDeviceSettings.xml"));
 
+/* optional <routing> element matching this station's speakers, applied after the test's own routing */
+const File stationRoutingFile(workingDirectory.getChildFile("stationRouting.xml"));
+
+/* loudness measured in earlier sessions, by file contents */
+const File loudnessCacheFile(workingDirectory.getChildFile("loudnessCache.xml"));
+
+/* results and interaction logs on their way to the stimuli directories, see ResultsReplicator */
+const File resultsSpoolDirectory(workingDirectory.getChildFile("ResultsSpool"));
+
+/* listings of the stimuli directories, one file per directory */
+const File stimulusIndexDirectory(workingDirectory.getChildFile("stimulusIndex"));
+
+/* optional <nullDevice> element setting up the device used on machines without audio hardware */
+const File nullDeviceSettingsFile(workingDirectory.getChildFile("nullDevice.xml"));
+
 #endif /* TEST_TYPES_H */
@@ -60,19 +60,37 @@ bool Trial::loadResults(XmlElement &trialXml, String &stimDirName) {
     refPlays = trialXml.getIntAttribute("referencePlays", -1);
     if (refPlays == -1) return false;
 
+    glitches.xruns = trialXml.getIntAttribute("xruns", 0);
+    glitches.lateCallbacks = trialXml.getIntAttribute("lateCallbacks", 0);
+    glitches.restarts = trialXml.getIntAttribute("deviceRestarts", 0);
+
     filesOrder.clear();
     soundFiles.clear();
     stimuliPlays.clear();
     responses.clear();
     comments.clear();
     responsesMoved.clear();
-
-    int numSoundFiles = trialXml.getNumChildElements();
+    listenedSeconds.clear();
+    auditions.clear();
+    loudness.clear();
+    levelGains.clear();
+
+    playbackLogs.clear();
+    int numSoundFiles = 0;
+    for (int i = 0; i < trialXml.getNumChildElements(); i++) {
+        const XmlElement *child = trialXml.getChildElement(i);
+        if (child->hasTagName("playbackLog")) {
+            /* earlier sessions' playback, kept so that it can still be rendered */
+            std::unique_ptr <PlaybackLog> log(new PlaybackLog);
+            if (log->loadFromXml(*child).isEmpty()) {
+                playbackLogs.add(log.release());
+            }
+        } else if (child->hasTagName("testFile")) {
+            numSoundFiles++;
+        }
+    }
 
     if (trialXml.getChildByName("videoFile") != nullptr) {
-        // This code assumes that the video file is the last element in the list
-        assert(trialXml.getChildElement(numSoundFiles - 1) == trialXml.getChildByName("videoFile"));
-        numSoundFiles--;
         videoFile = new File(
                 trialDir.getChildFile(trialXml.getChildByName("videoFile")->getStringAttribute("fileName", String())));
     } else {
@@ -96,6 +114,30 @@ bool Trial::loadResults(XmlElement &trialXml, String &stimDirName) {
         
         comments.add(fileInfo.getStringAttribute("comment", String()));
 
+        /* measured in an earlier session; silence was left out of the results */
+        if (fileInfo.hasAttribute("levelGainDb")) {
+            const double silence = -std::numeric_limits<double>::infinity();
+            LoudnessInfo info;
+            info.integratedLufs = fileInfo.getDoubleAttribute("loudnessLufs", silence);
+            info.truePeakDbtp = fileInfo.getDoubleAttribute("truePeakDbtp", silence);
+            loudness.add(info);
+            levelGains.add(Decibels::decibelsToGain((float) fileInfo.getDoubleAttribute("levelGainDb")));
+        }
+
+        listenedSeconds.add(fileInfo.getDoubleAttribute("listenedSeconds", 0.0));
+        for (int j = 0; j < fileInfo.getNumChildElements(); j++) {
+            const XmlElement *auditionXml = fileInfo.getChildElement(j);
+            if (!auditionXml->hasTagName("audition"))
+                continue;
+
+            const TrialAudition audition = {i, auditionXml->getDoubleAttribute("loopStart"),
+                                            auditionXml->getDoubleAttribute("loopEnd"),
+                                            auditionXml->getBoolAttribute("looping"),
+                                            auditionXml->getDoubleAttribute("seconds"),
+                                            auditionXml->getDoubleAttribute("startTime")};
+            auditions.add(audition);
+        }
+
         responsesMoved.add(false);
 
         if (soundFiles[i].containsIgnoreCase("REFERENCE")) {
@@ -103,6 +145,12 @@ bool Trial::loadResults(XmlElement &trialXml, String &stimDirName) {
         }
     }
 
+    /* saveResults() pairs them up with the files by index, so they are all or nothing */
+    if (loudness.size() != numSoundFiles) {
+        loudness.clear();
+        levelGains.clear();
+    }
+
     return true;
 }
 
@@ -113,6 +161,9 @@ void Trial::saveResults(XmlElement *parentXml) {
     resultsXml.setAttribute("trialName", testName);
     resultsXml.setAttribute("trialSeconds", round(elapsedTime.inSeconds()));
     resultsXml.setAttribute("referencePlays", refPlays);
+    resultsXml.setAttribute("xruns", glitches.xruns);
+    resultsXml.setAttribute("lateCallbacks", glitches.lateCallbacks);
+    resultsXml.setAttribute("deviceRestarts", glitches.restarts);
 
     for (int i = 0; i < soundFiles.size(); i++) {
         String tmp = soundFiles[filesOrder[i]];
@@ -126,6 +177,30 @@ void Trial::saveResults(XmlElement *parentXml) {
         if (comments[i].isNotEmpty()) {
             fileInfo.setAttribute("comment", comments[i]);
         }
+        if (filesOrder[i] < loudness.size()) {
+            const LoudnessInfo &info = loudness.getReference(filesOrder[i]);
+            if (std::isfinite(info.integratedLufs)) {
+                fileInfo.setAttribute("loudnessLufs", String(info.integratedLufs, 2));
+            }
+            if (std::isfinite(info.truePeakDbtp)) {
+                fileInfo.setAttribute("truePeakDbtp", String(info.truePeakDbtp, 2));
+            }
+            fileInfo.setAttribute("levelGainDb", String(Decibels::gainToDecibels(levelGains[filesOrder[i]]), 2));
+        }
+
+        fileInfo.setAttribute("listenedSeconds", String(listenedSeconds[filesOrder[i]], 3));
+        for (int j = 0; j < auditions.size(); j++) {
+            const TrialAudition &audition = auditions.getReference(j);
+            if (audition.stimulus != filesOrder[i])
+                continue;
+
+            XmlElement *auditionXml = fileInfo.createNewChildElement("audition");
+            auditionXml->setAttribute("loopStart", String(audition.loopStart, 3));
+            auditionXml->setAttribute("loopEnd", String(audition.loopEnd, 3));
+            auditionXml->setAttribute("looping", audition.looping ? 1 : 0);
+            auditionXml->setAttribute("seconds", String(audition.seconds, 3));
+            auditionXml->setAttribute("startTime", String(audition.startTime, 3));
+        }
         resultsXml.addChildElement(new XmlElement(fileInfo));
     }
 
@@ -135,5 +210,9 @@ void Trial::saveResults(XmlElement *parentXml) {
         resultsXml.addChildElement(new XmlElement(videoFileXml));
     }
 
+    for (int i = 0; i < playbackLogs.size(); i++) {
+        playbackLogs[i]->saveToXml(resultsXml);
+    }
+
     parentXml->addChildElement(new XmlElement(resultsXml));
 }
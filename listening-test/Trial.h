@@ -5,15 +5,31 @@
 #ifndef TRIAL_H
 #define TRIAL_H
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
+#include "Loudness.h"
+#include "PlaybackLog.h"
+#include "PlaybackDiagnostics.h"
 #include <random>
 #include <algorithm>
 
 void randomizeArrayOrder(Array<int> &anArray);
 
+/**
+    An Audition of one of the trial's stimuli, in seconds.
+*/
+struct TrialAudition {
+    int stimulus;       // index into soundFiles
+    double loopStart;
+    double loopEnd;
+    bool looping;
+    double seconds;     // listened, pauses excluded
+    double startTime;   // since the trial's stimuli were first loaded in this session
+};
+
 class Trial {
 public:
-    Trial() : refIndex(-1), refPlays(0), startTime(0), stopTime(0), startVolume(0), stopVolume(0) {};
+    Trial() : refIndex(-1), refPlays(0), glitches(), auditionBaseTicks(0), startTime(0), stopTime(0), startVolume(0),
+              stopVolume(0) {};
 
     ~Trial() {};
 
@@ -51,6 +67,21 @@ public:
     Array<bool> responsesMoved;
     String testName;
 
+    /* measured when the stimuli were loaded, in soundFiles order; empty if not measured */
+    Array<LoudnessInfo> loudness;
+    Array<float> levelGains;
+
+    /* what was played, one log for every time the trial's stimuli were loaded */
+    OwnedArray <PlaybackLog> playbackLogs;
+
+    /* dropouts while the trial was playing; a trial with any may have been rated on spoiled audio */
+    PlaybackGlitches glitches;
+
+    /* listening time of each stimulus, in soundFiles order, and the loop regions it was spent in */
+    Array<double> listenedSeconds;
+    Array <TrialAudition> auditions;
+    int64 auditionBaseTicks;    // when the stimuli were first loaded in this session, 0 before
+
 
 private:
     Time startTime;